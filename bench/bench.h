@@ -0,0 +1,88 @@
+#ifndef BENCH_H
+#define BENCH_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+// tiny microbenchmark harness shared by bench_server.c and bench_client.c
+// each benchmark is run with doubling iteration counts until one run takes
+// at least BENCH_MIN_NS, then reported as one JSON object per line on stdout
+// allocations are counted by defining malloc and friends in the bench binary,
+// glibc routes its own allocations (strdup, fopen, stdio buffers) through
+// them too, so hidden allocations inside libc calls are counted as well
+
+#define BENCH_MIN_NS 200000000LL  // 200 ms per reported run
+#define BENCH_START_ITERS 1000
+
+typedef void (*BenchFn)(void *arg);
+
+static unsigned long bench_allocs = 0;
+static volatile long bench_sink = 0;  // results go here so calls are not optimized away
+
+// the glibc allocator underneath, exported for exactly this purpose
+void *__libc_malloc(size_t size);
+void *__libc_calloc(size_t count, size_t size);
+void *__libc_realloc(void *ptr, size_t size);
+void __libc_free(void *ptr);
+
+void *malloc(size_t size) {
+    bench_allocs++;
+    return __libc_malloc(size);
+}
+
+void *calloc(size_t count, size_t size) {
+    bench_allocs++;
+    return __libc_calloc(count, size);
+}
+
+void *realloc(void *ptr, size_t size) {
+    bench_allocs++;
+    return __libc_realloc(ptr, size);
+}
+
+void free(void *ptr) {
+    __libc_free(ptr);
+}
+
+static long long bench_now_ns() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long long)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+// time fn and print {"target","bench","clients","payload","iters","ns_per_op","allocs_per_op"}
+// clients and payload are 0 when the benchmark does not vary them
+static void bench_run(const char *target, const char *name, int clients, int payload,
+                      BenchFn fn, void *arg) {
+    long long iters = BENCH_START_ITERS;
+    long long elapsed;
+    unsigned long allocs;
+
+    // warm up caches and branch predictors
+    for (long long i = 0; i < BENCH_START_ITERS; i++) {
+        fn(arg);
+    }
+
+    while (1) {
+        allocs = bench_allocs;
+        long long start = bench_now_ns();
+        for (long long i = 0; i < iters; i++) {
+            fn(arg);
+        }
+        elapsed = bench_now_ns() - start;
+        allocs = bench_allocs - allocs;
+        if (elapsed >= BENCH_MIN_NS) {
+            break;
+        }
+        iters *= 2;
+    }
+
+    printf("{\"target\":\"%s\",\"bench\":\"%s\",\"clients\":%d,\"payload\":%d,"
+           "\"iters\":%lld,\"ns_per_op\":%.2f,\"allocs_per_op\":%.4f}\n",
+           target, name, clients, payload, iters,
+           (double)elapsed / iters, (double)allocs / iters);
+    fflush(stdout);
+}
+
+#endif
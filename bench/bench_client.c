@@ -0,0 +1,69 @@
+// microbenchmarks for the client's protocol parsing and queue hot paths
+// client.c is included directly so its file-local state can be set up here
+#define main client_main
+#include "../client.c"
+#undef main
+
+#include "bench.h"
+
+static const int payload_sizes[] = {16, 128, 900};
+static const int slot_counts[] = {1, 10};  // frame sizes written into SLOT_ACTIVE lines
+
+static char line[2 * BUFFER_SIZE];
+static char payload[BUFFER_SIZE];
+
+static void bench_parse_slot_active(void *arg) {
+    parse_slot_active(line);
+    bench_sink += tdma_info.current_slot;
+}
+
+static void bench_parse_message(void *arg) {
+    parse_message(line);
+    bench_sink++;
+}
+
+static void bench_handle_server_line(void *arg) {
+    handle_server_line(line);
+    bench_sink++;
+}
+
+static void bench_queue_round_trip(void *arg) {
+    char out[BUFFER_SIZE];
+    enqueue_message(payload);
+    bench_sink += dequeue_message(out);
+}
+
+int main() {
+    // test mode keeps the parsers from printing
+    client_mode = MODE_TEST;
+    init_message_queue();
+    init_tdma_info();
+    init_test_stats();
+    init_bulk();
+    
+    for (int c = 0; c < (int)(sizeof(slot_counts) / sizeof(slot_counts[0])); c++) {
+        int n = slot_counts[c];
+        
+        snprintf(line, sizeof(line), "SLOT_ACTIVE|your_turn=1|slot=%d|duration=100|active_slots=%d|credits=64",
+                 n - 1, n);
+        bench_run("client", "parse_slot_active_turn", n, 0, bench_parse_slot_active, NULL);
+        
+        snprintf(line, sizeof(line),
+                 "SLOT_ACTIVE|your_turn=0|current_slot=%d|your_slot=0|wait_time=%d|active_slots=%d",
+                 n - 1, 100 * n, n);
+        bench_run("client", "parse_slot_active_wait", n, 0, bench_parse_slot_active, NULL);
+    }
+    
+    for (int p = 0; p < (int)(sizeof(payload_sizes) / sizeof(payload_sizes[0])); p++) {
+        int size = payload_sizes[p];
+        memset(payload, 'x', size);
+        payload[size] = '\0';
+        
+        snprintf(line, sizeof(line), "MESSAGE|from=2|slot=1|text=%s", payload);
+        bench_run("client", "parse_message", 0, size, bench_parse_message, NULL);
+        bench_run("client", "handle_server_line", 0, size, bench_handle_server_line, NULL);
+        bench_run("client", "queue_round_trip", 0, size, bench_queue_round_trip, NULL);
+    }
+    
+    return 0;
+}
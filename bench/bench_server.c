@@ -0,0 +1,65 @@
+// microbenchmarks for the server's scheduling and formatting hot paths
+// server.c is included directly so its file-local state can be set up here
+#define main server_main
+#include "../server.c"
+#undef main
+
+#include "bench.h"
+
+static const int client_counts[] = {1, 2, 5, MAX_CLIENTS};
+static const int payload_sizes[] = {16, 128, 900};
+
+static char payload[BUFFER_SIZE];
+
+// mark the first n clients connected without printing like update_active_slots()
+static void setup_clients(int n) {
+    initialize_clients();
+    initialize_tdma();
+    for (int i = 0; i < n; i++) {
+        clients[i].active = 1;
+        clients[i].slot_number = i;
+    }
+    client_count = n;
+    tdma.active_slots = n;
+}
+
+static void bench_get_current_active_client(void *arg) {
+    bench_sink += get_current_active_client();
+}
+
+static void bench_update_tdma_slot(void *arg) {
+    update_tdma_slot();
+    bench_sink += tdma.current_slot;
+}
+
+static void bench_get_time_to_client_slot(void *arg) {
+    bench_sink += get_time_to_client_slot(tdma.active_slots - 1);
+}
+
+static void bench_format_message(void *arg) {
+    char out[BUFFER_SIZE + 50];
+    bench_sink += format_message(out, sizeof(out), payload, 0);
+}
+
+int main() {
+    for (int c = 0; c < (int)(sizeof(client_counts) / sizeof(client_counts[0])); c++) {
+        int n = client_counts[c];
+        setup_clients(n);
+        
+        // worst case, the active slot belongs to the last client
+        tdma.current_slot = n - 1;
+        bench_run("server", "get_current_active_client", n, 0, bench_get_current_active_client, NULL);
+        bench_run("server", "get_time_to_client_slot", n, 0, bench_get_time_to_client_slot, NULL);
+        bench_run("server", "update_tdma_slot", n, 0, bench_update_tdma_slot, NULL);
+    }
+    
+    setup_clients(MAX_CLIENTS);
+    for (int p = 0; p < (int)(sizeof(payload_sizes) / sizeof(payload_sizes[0])); p++) {
+        int size = payload_sizes[p];
+        memset(payload, 'x', size);
+        payload[size] = '\0';
+        bench_run("server", "format_message", MAX_CLIENTS, size, bench_format_message, NULL);
+    }
+    
+    return 0;
+}
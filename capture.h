@@ -0,0 +1,30 @@
+#ifndef CAPTURE_H
+#define CAPTURE_H
+
+#include <stdint.h>
+
+// binary traffic capture written by ./server -r and read by ./replay
+// file layout: CAPTURE_MAGIC, then CaptureRecord headers each followed by len payload bytes
+
+#define CAPTURE_MAGIC "TDMACAP1"
+#define CAPTURE_MAGIC_LEN 8
+
+// Enum for capture record types
+typedef enum {
+    CAP_ACCEPT = 1,      // client connected, payload is its sockaddr_in
+    CAP_DISCONNECT = 2,  // client connection closed
+    CAP_PAYLOAD = 3,     // bytes read from a client socket
+    CAP_SLOT = 4         // TDMA slot transition
+} CaptureType;
+
+// fixed 16 byte record header, stored in host byte order
+typedef struct {
+    uint64_t time_us;      // monotonic time since the capture started
+    uint8_t type;          // CaptureType
+    uint8_t client;        // client index on the server
+    uint8_t slot;          // current TDMA slot when logged
+    uint8_t active_slots;  // slots in the frame when logged
+    uint32_t len;          // payload bytes following this header
+} CaptureRecord;
+
+#endif
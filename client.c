@@ -7,10 +7,37 @@
 #include <pthread.h>
 #include <signal.h>
 #include <sys/time.h>
+#include <stdint.h>
+#include <errno.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <sys/un.h>
+#include <sys/mman.h>
+#include "shm_ring.h"
+#include "config.h"
 
 #define BUFFER_SIZE 1024
-#define QUEUE_SIZE 10
-#define TEST_INTERVAL_MS 33  // Send test message every 33ms
+#define QUEUE_BYTES (10 * BUFFER_SIZE)  // largest byte budget for queued messages, and the default
+#define MIN_QUEUE_BYTES (2 * BUFFER_SIZE)  // smallest budget, still fits a full-size message
+#define RECORD_HDR ((int)sizeof(uint16_t))  // length prefix in front of each record
+#define RECORD_WRAP 0xFFFF  // length marker telling the reader to skip to offset 0
+#define TEST_MSG_MAX 96  // upper bound for one generated test message
+#define FRAG_CHUNK 400  // payload bytes per fragment (hex encoded on the wire)
+#define FRAG_MSG_MAX (64 + 2 * FRAG_CHUNK)  // fragment header plus hex payload
+#define MAX_TRANSFER_BYTES (256 * 1024)  // largest bulk payload
+#define REASSEMBLY_SLOTS 4  // bulk transfers that can be received at once
+#define FRAG_CHUNKS (MAX_TRANSFER_BYTES / FRAG_CHUNK + 1)
+#define SLOT_GUARD_MS 10  // stop transmitting this long before our slot ends
+#define SLOT_GUARD_MIN_MS 2  // smallest guard once the server reports our timing
+#define SYNC_TAG "SYNC|"  // marks a line sent from a backlog at the start of our turn
+#define SYNC_TAG_LEN 5
+#define TOKEN_LEN 16  // hex characters in the server's resume token
+#define RECONNECT_MIN_MS 50  // first retry delay after a failed reconnect
+#define RECONNECT_MAX_MS 2000  // retry delay cap
+#define USER_TIMEOUT_MS 500  // drop a link whose sent data goes unacked this long
+#define TEST_INTERVAL_MS 33  // default, Send test message every 33ms
+#define SERVER_PORT 8080  // default server port
 
 // Enum for selecting client mode
 typedef enum {
@@ -19,11 +46,18 @@ typedef enum {
 } ClientMode;
 
 // structure for FIFO message queue
+// records are stored back to back in one byte ring as [uint16 length][text],
+// so the queue is limited by total bytes instead of a fixed message count
 typedef struct {
-    char messages[QUEUE_SIZE][BUFFER_SIZE];
-    int front;
-    int rear;
-    int count;
+    char data[QUEUE_BYTES];
+    int capacity;     // bytes of data in use as the ring, at most QUEUE_BYTES
+    int next_capacity;  // reloaded capacity, taken over once the queue is empty
+    int head;         // offset of the oldest record
+    int tail;         // offset where the next record is written
+    int used;         // bytes in use, including headers and wrap padding
+    int count;        // number of records queued
+    int reserve_pos;  // offset handed out by queue_reserve()
+    int reserve_pad;  // padding skipped at the end of the ring for that reservation
     pthread_mutex_t lock;
 } MessageQueue;
 
@@ -33,6 +67,11 @@ typedef struct {
     int current_slot;
     int slot_duration_ms;
     int my_turn;
+    int credits;  // messages the server lets us send this slot, -1 for no limit
+    int granted_credits;  // size of the latest grant, -1 if none
+    long long turn_start;  // local time our current slot started
+    int backlog_at_start;  // messages were already queued when our turn began
+    int stop_margin_ms;    // stop transmitting this long before our slot ends
     long long time_to_my_slot;
     pthread_mutex_t lock;
 } TDMAInfo;
@@ -41,16 +80,70 @@ typedef struct {
 typedef struct {
     unsigned long messages_sent;
     unsigned long messages_queued;
+    unsigned long messages_throttled;  // generation skipped for lack of credits
     pthread_mutex_t lock;
 } TestStats;
 
+// settings from the command line and the config file
+typedef struct {
+    int port;
+    int test_interval_ms;
+    int queue_bytes;
+} ClientConfig;
+
+// one bulk transfer being reassembled from fragments
+typedef struct {
+    int active;
+    int from_id;
+    unsigned int msg_id;
+    unsigned int total;
+    unsigned int received;
+    long long start_time;
+    unsigned char have[FRAG_CHUNKS];  // which chunks arrived
+    char data[MAX_TRANSFER_BYTES];
+} Reassembly;
+
+// stats for fragmented bulk transfers
+typedef struct {
+    unsigned long transfers_sent;
+    unsigned long fragments_queued;
+    unsigned long fragments_sent;
+    unsigned long fragments_resent;
+    unsigned long long bytes_sent;
+    unsigned long transfers_received;
+    unsigned long transfers_dropped;
+    unsigned long fragments_received;
+    unsigned long long bytes_received;
+    pthread_mutex_t lock;
+} BulkStats;
+
 int sock = 0;
 int running = 1;
+volatile int connected = 0;  // cleared while reconnecting after a dropped link
+struct sockaddr_in server_addr;
+char resume_token[TOKEN_LEN + 1] = "";
+int resuming = 0;  // RESUME sent, waiting for RESUMED or RESUME_FAILED
+char welcome_token[TOKEN_LEN + 1] = "";  // token of the temporary entry, kept in case the resume fails
+long long disconnect_time = 0;
+ShmRegion *local_shm = NULL;  // rings shared with a server on this host, NULL over TCP
+int local_doorbell_tx = -1;   // rung after writing to_server
+int local_doorbell_rx = -1;   // rung by the server after writing to_client
 int client_id = 0;
 ClientMode client_mode = MODE_INTERACTIVE;
 MessageQueue msg_queue;
 TDMAInfo tdma_info;
-TestStats test_stats = {0, 0};
+TestStats test_stats = {0, 0, 0};
+Reassembly reassembly[REASSEMBLY_SLOTS];
+BulkStats bulk_stats;
+char bulk_tx_buf[MAX_TRANSFER_BYTES];
+unsigned int next_msg_id = 1;
+unsigned int bulk_tx_id = 0;  // transfer currently being sent, 0 if none
+unsigned int bulk_resend[FRAG_CHUNKS];  // offsets dropped by the server
+int bulk_resend_count = 0;
+ClientConfig config = {SERVER_PORT, TEST_INTERVAL_MS, QUEUE_BYTES};
+const char *config_path = NULL;
+volatile sig_atomic_t reload_requested = 0;
+int server_max_message = 0;  // from the server's CONFIG line, 0 until it arrives
 
 // Get current time in milliseconds
 long long get_time_ms() {
@@ -60,9 +153,14 @@ long long get_time_ms() {
 }
 
 void init_message_queue() {
-    msg_queue.front = 0;
-    msg_queue.rear = -1;
+    msg_queue.capacity = config.queue_bytes;
+    msg_queue.next_capacity = config.queue_bytes;
+    msg_queue.head = 0;
+    msg_queue.tail = 0;
+    msg_queue.used = 0;
     msg_queue.count = 0;
+    msg_queue.reserve_pos = -1;
+    msg_queue.reserve_pad = 0;
     pthread_mutex_init(&msg_queue.lock, NULL);
 }
 
@@ -71,6 +169,11 @@ void init_tdma_info() {
     tdma_info.current_slot = -1;
     tdma_info.slot_duration_ms = 0;
     tdma_info.my_turn = 0;
+    tdma_info.credits = -1;
+    tdma_info.granted_credits = -1;
+    tdma_info.turn_start = 0;
+    tdma_info.backlog_at_start = 0;
+    tdma_info.stop_margin_ms = SLOT_GUARD_MS;
     tdma_info.time_to_my_slot = 0;
     pthread_mutex_init(&tdma_info.lock, NULL);
 }
@@ -78,30 +181,120 @@ void init_tdma_info() {
 void init_test_stats() {
     test_stats.messages_sent = 0;
     test_stats.messages_queued = 0;
+    test_stats.messages_throttled = 0;
     pthread_mutex_init(&test_stats.lock, NULL);
 }
 
-// add mesage to queue
-int enqueue_message(const char *msg) {
+// reserve room for a record of up to max_len bytes and return a pointer to
+// write it in place. max_len + 1 bytes are writable so snprintf can be used
+// directly. the queue stays locked until queue_commit() or queue_cancel()
+char *queue_reserve(int max_len) {
+    int need = RECORD_HDR + max_len + 1;
+    int pos = -1;
+    int pad = 0;
+    
+    if (max_len < 0 || max_len > BUFFER_SIZE - 1) {
+        return NULL;
+    }
+    
     pthread_mutex_lock(&msg_queue.lock);
     
+    if (msg_queue.count == 0) {
+        // empty, restart at the beginning so records stay contiguous
+        // and a reloaded size can take effect
+        msg_queue.capacity = msg_queue.next_capacity;
+        msg_queue.head = 0;
+        msg_queue.tail = 0;
+        msg_queue.used = 0;
+    }
+    
+    if (msg_queue.tail > msg_queue.head || msg_queue.used == 0) {
+        // free space is [tail, end) plus [0, head)
+        int end_space = msg_queue.capacity - msg_queue.tail;
+        if (end_space >= need) {
+            pos = msg_queue.tail;
+        } else if (msg_queue.head >= need) {
+            pos = 0;
+            pad = end_space;
+        }
+    } else if (msg_queue.head - msg_queue.tail >= need) {
+        // free space is [tail, head)
+        pos = msg_queue.tail;
+    }
+    
     // if queue full, reject
-    if (msg_queue.count >= QUEUE_SIZE) {
+    if (pos < 0) {
         pthread_mutex_unlock(&msg_queue.lock);
-        return 0;  // Queue full
+        return NULL;
+    }
+    
+    msg_queue.reserve_pos = pos;
+    msg_queue.reserve_pad = pad;
+    return msg_queue.data + pos + RECORD_HDR;
+}
+
+// publish the record written into the last reservation
+void queue_commit(int len) {
+    uint16_t hdr = (uint16_t)len;
+    
+    if (msg_queue.reserve_pad > 0) {
+        // mark the unused tail of the ring so the reader wraps to 0
+        if (msg_queue.reserve_pad >= RECORD_HDR) {
+            uint16_t wrap = RECORD_WRAP;
+            memcpy(msg_queue.data + msg_queue.tail, &wrap, RECORD_HDR);
+        }
+        msg_queue.used += msg_queue.reserve_pad;
     }
     
-    msg_queue.rear = (msg_queue.rear + 1) % QUEUE_SIZE;
-    strncpy(msg_queue.messages[msg_queue.rear], msg, BUFFER_SIZE - 1);
-    msg_queue.messages[msg_queue.rear][BUFFER_SIZE - 1] = '\0';
+    memcpy(msg_queue.data + msg_queue.reserve_pos, &hdr, RECORD_HDR);
+    msg_queue.tail = msg_queue.reserve_pos + RECORD_HDR + len;
+    if (msg_queue.tail == msg_queue.capacity) {
+        msg_queue.tail = 0;
+    }
+    msg_queue.used += RECORD_HDR + len;
     msg_queue.count++;
+    msg_queue.reserve_pos = -1;
+    msg_queue.reserve_pad = 0;
     
     pthread_mutex_unlock(&msg_queue.lock);
+}
+
+// drop the last reservation without queuing anything
+void queue_cancel() {
+    msg_queue.reserve_pos = -1;
+    msg_queue.reserve_pad = 0;
+    pthread_mutex_unlock(&msg_queue.lock);
+}
+
+void init_bulk() {
+    memset(&bulk_stats, 0, sizeof(bulk_stats));
+    pthread_mutex_init(&bulk_stats.lock, NULL);
+    for (int i = 0; i < REASSEMBLY_SLOTS; i++) {
+        reassembly[i].active = 0;
+    }
+}
+
+// add mesage to queue
+int enqueue_message(const char *msg) {
+    int len = strlen(msg);
+    if (len > BUFFER_SIZE - 1) {
+        len = BUFFER_SIZE - 1;
+    }
+    
+    char *slot = queue_reserve(len);
+    if (slot == NULL) {
+        return 0;  // Queue full
+    }
+    
+    memcpy(slot, msg, len);
+    queue_commit(len);
     return 1;
 }
 
 // remove messge from queue
 int dequeue_message(char *msg) {
+    uint16_t len;
+    
     pthread_mutex_lock(&msg_queue.lock);
     
     // if queue empty, return nothing
@@ -110,8 +303,26 @@ int dequeue_message(char *msg) {
         return 0;  // Queue empty
     }
     
-    strcpy(msg, msg_queue.messages[msg_queue.front]);
-    msg_queue.front = (msg_queue.front + 1) % QUEUE_SIZE;
+    // skip wrap padding at the end of the ring
+    int end_space = msg_queue.capacity - msg_queue.head;
+    if (end_space < RECORD_HDR) {
+        len = RECORD_WRAP;
+    } else {
+        memcpy(&len, msg_queue.data + msg_queue.head, RECORD_HDR);
+    }
+    if (len == RECORD_WRAP) {
+        msg_queue.used -= end_space;
+        msg_queue.head = 0;
+        memcpy(&len, msg_queue.data, RECORD_HDR);
+    }
+    
+    memcpy(msg, msg_queue.data + msg_queue.head + RECORD_HDR, len);
+    msg[len] = '\0';
+    msg_queue.head += RECORD_HDR + len;
+    if (msg_queue.head == msg_queue.capacity) {
+        msg_queue.head = 0;
+    }
+    msg_queue.used -= RECORD_HDR + len;
     msg_queue.count--;
     
     pthread_mutex_unlock(&msg_queue.lock);
@@ -121,10 +332,22 @@ int dequeue_message(char *msg) {
 // parses server welcome messge containing clot conig
 void parse_welcome_message(const char *msg) {
 
-    // Format: WELCOME|client_id=X|slot=Y|slot_duration=Z
+    // Format: WELCOME|client_id=X|slot=Y|slot_duration=Z|token=T
     sscanf(msg, "WELCOME|client_id=%d|slot=%d|slot_duration=%d",
            &client_id, &tdma_info.my_slot, &tdma_info.slot_duration_ms);
     
+    // while resuming this is only a temporary assignment, RESUMED replaces it,
+    // but its token is what we keep if RESUME_FAILED comes back instead
+    const char *token = strstr(msg, "|token=");
+    welcome_token[0] = '\0';
+    if (token != NULL) {
+        sscanf(token, "|token=%16s", welcome_token);
+    }
+    if (resuming) {
+        return;
+    }
+    strcpy(resume_token, welcome_token);
+    
            // if in interacting mode, print assigned parameters
     if (client_mode == MODE_INTERACTIVE) {
         printf("\n=== TDMA Configuration ===\n");
@@ -137,14 +360,49 @@ void parse_welcome_message(const char *msg) {
     }
 }
 
+// parses the reply to RESUME after a reconnect
+void parse_resume_reply(const char *msg) {
+    // Format: RESUMED|client_id=X|slot=Y|slot_duration=Z|token=T or RESUME_FAILED
+    long long outage = get_time_ms() - disconnect_time;
+    resuming = 0;
+    
+    if (sscanf(msg, "RESUMED|client_id=%d|slot=%d|slot_duration=%d|token=%16s",
+               &client_id, &tdma_info.my_slot, &tdma_info.slot_duration_ms, resume_token) == 4) {
+        printf("\n[RESUME] Session resumed as Client %d in Slot %d after %lld ms\n",
+               client_id, tdma_info.my_slot, outage);
+    } else {
+        // the grace period ran out, keep the fresh assignment from WELCOME
+        strcpy(resume_token, welcome_token);
+        printf("\n[RESUME] Session expired, rejoined as Client %d in Slot %d after %lld ms\n",
+               client_id, tdma_info.my_slot, outage);
+    }
+}
+
 // parses periodic TDMA timing/status messages
 void parse_tdma_info(const char *msg) {
-    // Format: TDMA_INFO|slot=X|slot_duration=Y|frame=Z|time_to_slot=W
-    int frame;
+    // Format: TDMA_INFO|slot=X|slot_duration=Y|frame=Z|time_to_slot=W|active_slots=N|lag=L|guard=G
+    int frame, lag, guard;
     pthread_mutex_lock(&tdma_info.lock);
     sscanf(msg, "TDMA_INFO|slot=%d|slot_duration=%d|frame=%d|time_to_slot=%lld",
            &tdma_info.my_slot, &tdma_info.slot_duration_ms, 
            &frame, &tdma_info.time_to_my_slot);
+    
+    // the server measured our messages arriving lag ms into the slot and
+    // accepts them up to guard ms after it, so stop just early enough that
+    // the last one still lands inside that window. until it has a
+    // measurement (lag=-1) keep the default margin
+    int margin = SLOT_GUARD_MS;
+    const char *timing = strstr(msg, "|lag=");
+    if (timing != NULL && sscanf(timing, "|lag=%d|guard=%d", &lag, &guard) == 2 && lag >= 0) {
+        margin = lag - guard + SLOT_GUARD_MIN_MS;
+        if (margin < SLOT_GUARD_MIN_MS) {
+            margin = SLOT_GUARD_MIN_MS;
+        }
+    }
+    if (margin > tdma_info.slot_duration_ms / 2) {
+        margin = tdma_info.slot_duration_ms / 2;
+    }
+    tdma_info.stop_margin_ms = margin;
     pthread_mutex_unlock(&tdma_info.lock);
 }
 
@@ -156,12 +414,25 @@ void parse_slot_active(const char *msg) {
     
     // if message fromat starts with your_turn, update TDMA turn info
     if (sscanf(msg, "SLOT_ACTIVE|your_turn=%d", &your_turn) == 1) {
+        if (your_turn && !tdma_info.my_turn) {
+            tdma_info.turn_start = get_time_ms();
+            // only a line that was waiting when the turn began is sent right
+            // at its start, so only that one tells the server our lag
+            tdma_info.backlog_at_start = msg_queue.count > 0;
+        }
         tdma_info.my_turn = your_turn;
         
         // If it's our turn, parse active slot and duration
         if (your_turn) {
-            sscanf(msg, "SLOT_ACTIVE|your_turn=%d|slot=%d|duration=%d",
-                   &your_turn, &tdma_info.current_slot, &tdma_info.slot_duration_ms);
+            int active_slots, credits;
+            if (sscanf(msg, "SLOT_ACTIVE|your_turn=%d|slot=%d|duration=%d|active_slots=%d|credits=%d",
+                       &your_turn, &tdma_info.current_slot, &tdma_info.slot_duration_ms,
+                       &active_slots, &credits) == 5) {
+                tdma_info.credits = credits;
+            } else {
+                tdma_info.credits = -1;  // server without flow control
+            }
+            tdma_info.granted_credits = tdma_info.credits;
         } else {
             long long wait_time;
             sscanf(msg, "SLOT_ACTIVE|your_turn=%d|current_slot=%d|your_slot=%d|wait_time=%lld",
@@ -172,6 +443,138 @@ void parse_slot_active(const char *msg) {
     pthread_mutex_unlock(&tdma_info.lock);
 }
 
+int hex_value(char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+// find the reassembly buffer for a transfer, claiming a free one if needed
+Reassembly *get_reassembly(int from_id, unsigned int msg_id, unsigned int total) {
+    Reassembly *oldest = NULL;
+    
+    for (int i = 0; i < REASSEMBLY_SLOTS; i++) {
+        Reassembly *r = &reassembly[i];
+        if (r->active && r->from_id == from_id && r->msg_id == msg_id) {
+            return r;
+        }
+    }
+    
+    for (int i = 0; i < REASSEMBLY_SLOTS; i++) {
+        Reassembly *r = &reassembly[i];
+        if (!r->active) {
+            oldest = r;
+            break;
+        }
+        // a new transfer from the same sender means the old one won't finish
+        if (r->from_id == from_id) {
+            oldest = r;
+            break;
+        }
+        if (oldest == NULL || r->start_time < oldest->start_time) {
+            oldest = r;
+        }
+    }
+    
+    if (oldest->active) {
+        printf("\n[BULK] Dropping incomplete transfer %u from Client %d (%u/%u bytes)\n",
+               oldest->msg_id, oldest->from_id, oldest->received, oldest->total);
+        pthread_mutex_lock(&bulk_stats.lock);
+        bulk_stats.transfers_dropped++;
+        pthread_mutex_unlock(&bulk_stats.lock);
+    }
+    
+    oldest->active = 1;
+    oldest->from_id = from_id;
+    oldest->msg_id = msg_id;
+    oldest->total = total;
+    oldest->received = 0;
+    oldest->start_time = get_time_ms();
+    memset(oldest->have, 0, sizeof(oldest->have));
+    return oldest;
+}
+
+// write a completed transfer to disk and report its throughput
+void finish_reassembly(Reassembly *r) {
+    char filename[64];
+    long long elapsed = get_time_ms() - r->start_time;
+    
+    snprintf(filename, sizeof(filename), "bulk_client%d_%u.bin", r->from_id, r->msg_id);
+    FILE *fp = fopen(filename, "wb");
+    if (fp != NULL) {
+        fwrite(r->data, 1, r->total, fp);
+        fclose(fp);
+    }
+    
+    printf("\n[BULK] Received transfer %u from Client %d: %u bytes in %lld ms (%.1f KB/s) -> %s\n",
+           r->msg_id, r->from_id, r->total, elapsed,
+           elapsed > 0 ? (r->total / 1024.0) / (elapsed / 1000.0) : 0.0,
+           fp != NULL ? filename : "(not saved)");
+    
+    pthread_mutex_lock(&bulk_stats.lock);
+    bulk_stats.transfers_received++;
+    pthread_mutex_unlock(&bulk_stats.lock);
+    r->active = 0;
+}
+
+// handle one fragment of a bulk transfer from another client
+void handle_fragment(int from_id, const char *text) {
+    // Format: FRAG|id=X|off=Y|total=Z|data=HEX
+    unsigned int msg_id, offset, total;
+    int data_pos = 0;
+    
+    if (sscanf(text, "FRAG|id=%u|off=%u|total=%u|data=%n",
+               &msg_id, &offset, &total, &data_pos) != 3 || data_pos == 0) {
+        return;
+    }
+    
+    const char *hex = text + data_pos;
+    unsigned int len = strlen(hex) / 2;
+    // compare by subtraction, offset + len can wrap for a hostile offset
+    if (total > MAX_TRANSFER_BYTES || offset > total || len > total - offset ||
+        offset % FRAG_CHUNK != 0 || len > FRAG_CHUNK) {
+        return;
+    }
+    
+    // later fragments must also fit the buffer claimed by the first one
+    Reassembly *r = get_reassembly(from_id, msg_id, total);
+    if (offset > r->total || len > r->total - offset) {
+        return;
+    }
+    int chunk = offset / FRAG_CHUNK;
+    if (r->have[chunk]) {
+        return;  // duplicate
+    }
+    
+    for (unsigned int i = 0; i < len; i++) {
+        int hi = hex_value(hex[2 * i]);
+        int lo = hex_value(hex[2 * i + 1]);
+        if (hi < 0 || lo < 0) {
+            return;
+        }
+        r->data[offset + i] = (char)((hi << 4) | lo);
+    }
+    r->have[chunk] = 1;
+    unsigned int before = r->received;
+    r->received += len;
+    
+    // report progress at every quarter of a transfer
+    if (r->received < r->total && r->received * 4 / r->total != before * 4 / r->total) {
+        printf("\n[BULK] Transfer %u from Client %d: %u/%u bytes\n",
+               r->msg_id, r->from_id, r->received, r->total);
+    }
+    
+    pthread_mutex_lock(&bulk_stats.lock);
+    bulk_stats.fragments_received++;
+    bulk_stats.bytes_received += len;
+    pthread_mutex_unlock(&bulk_stats.lock);
+    
+    if (r->received >= r->total) {
+        finish_reassembly(r);
+    }
+}
+
 // Parses a normal message sent by another client
 void parse_message(const char *msg) {
     // Format: MESSAGE|from=X|slot=Y|text=Z
@@ -181,17 +584,59 @@ void parse_message(const char *msg) {
     // If message matches the expected format
     if (sscanf(msg, "MESSAGE|from=%d|slot=%d|text=%[^\n]", 
                &from_id, &from_slot, text) == 3) {
-        if (client_mode == MODE_INTERACTIVE) {
+        if (strncmp(text, "FRAG|", 5) == 0) {
+            handle_fragment(from_id, text);
+        } else if (client_mode == MODE_INTERACTIVE) {
             printf("\n[Client %d, Slot %d]: %s\n", from_id, from_slot, text);
         }
         // In test mode, silently receive (observe via Wireshark)
     }
 }
 
+// parses the limits the server currently enforces, sent after WELCOME and
+// again whenever the server reloads its configuration
+void parse_config_message(const char *msg) {
+    // Format: CONFIG|slot_duration=X|max_clients=Y|max_message=Z
+    int slot_duration, max_clients, max_message;
+    
+    if (sscanf(msg, "CONFIG|slot_duration=%d|max_clients=%d|max_message=%d",
+               &slot_duration, &max_clients, &max_message) != 3) {
+        return;
+    }
+    
+    pthread_mutex_lock(&tdma_info.lock);
+    int changed = server_max_message != 0 &&
+        (slot_duration != tdma_info.slot_duration_ms || max_message != server_max_message);
+    tdma_info.slot_duration_ms = slot_duration;
+    server_max_message = max_message;
+    pthread_mutex_unlock(&tdma_info.lock);
+    
+    if (changed) {
+        printf("\n[CONFIG] Server settings changed: slot %d ms, up to %d clients, messages up to %d bytes\n",
+               slot_duration, max_clients, max_message);
+        if (client_mode == MODE_INTERACTIVE) {
+            printf("Enter message: ");
+            fflush(stdout);
+        }
+    }
+}
+
 // handle collisions
 void parse_collision(const char *msg) {
     // Format: COLLISION|your_slot=X|current_slot=Y|message_dropped
     int your_slot, current_slot;
+    unsigned int frag_id, frag_off;
+    
+    // dropped fragments of our running transfer are sent again
+    const char *frag = strstr(msg, "|frag=");
+    if (frag != NULL && sscanf(frag, "|frag=%u:%u", &frag_id, &frag_off) == 2) {
+        pthread_mutex_lock(&bulk_stats.lock);
+        if (frag_id == bulk_tx_id && bulk_resend_count < FRAG_CHUNKS) {
+            bulk_resend[bulk_resend_count++] = frag_off;
+        }
+        pthread_mutex_unlock(&bulk_stats.lock);
+        return;
+    }
     
     if (sscanf(msg, "COLLISION|your_slot=%d|current_slot=%d", 
                &your_slot, &current_slot) == 2) {
@@ -212,49 +657,297 @@ void signal_handler(int sig) {
     exit(0);
 }
 
+// parse one client setting into a ClientConfig, used for -c files and reloads
+int apply_client_setting(void *target, const char *key, const char *value) {
+    ClientConfig *cfg = target;
+    char *end;
+    long number = strtol(value, &end, 10);
+    
+    if (*value == '\0' || *end != '\0') {
+        return -1;
+    }
+    
+    if (strcmp(key, "port") == 0 && number > 0 && number <= 65535) {
+        cfg->port = number;
+    } else if (strcmp(key, "test_interval_ms") == 0 && number >= 1 && number <= 60000) {
+        cfg->test_interval_ms = number;
+    } else if (strcmp(key, "queue_bytes") == 0 && number >= MIN_QUEUE_BYTES && number <= QUEUE_BYTES) {
+        cfg->queue_bytes = number;
+    } else {
+        return -1;
+    }
+    return 0;
+}
+
+// SIGHUP asks for the config file to be read again
+void reload_handler(int sig) {
+    (void)sig;
+    reload_requested = 1;
+}
+
+// re-read the config file, the port only matters for the next start
+void reload_config() {
+    reload_requested = 0;
+    if (config_path == NULL) {
+        printf("\n[CONFIG] Reload requested but no config file was given with -c\n");
+        return;
+    }
+    
+    ClientConfig loaded = config;
+    int errors = config_load(config_path, apply_client_setting, &loaded);
+    if (errors != 0) {
+        printf("\n[CONFIG] %s %s, keeping current settings\n",
+               config_path, errors < 0 ? "could not be read" : "has errors");
+        return;
+    }
+    
+    config.test_interval_ms = loaded.test_interval_ms;
+    config.queue_bytes = loaded.queue_bytes;
+    pthread_mutex_lock(&msg_queue.lock);
+    msg_queue.next_capacity = loaded.queue_bytes;
+    pthread_mutex_unlock(&msg_queue.lock);
+    printf("\n[CONFIG] Reloaded %s: test interval %d ms, queue %d bytes\n",
+           config_path, config.test_interval_ms, config.queue_bytes);
+}
+
+// dispatch one newline terminated message from the server
+void handle_server_line(const char *line) {
+    // Parse different message types
+    if (strncmp(line, "WELCOME|", 8) == 0) {
+        parse_welcome_message(line);
+    } else if (strncmp(line, "RESUMED|", 8) == 0 || strncmp(line, "RESUME_FAILED", 13) == 0) {
+        parse_resume_reply(line);
+    } else if (strncmp(line, "TDMA_INFO|", 10) == 0) {
+        parse_tdma_info(line);
+    } else if (strncmp(line, "SLOT_ACTIVE|", 12) == 0) {
+        parse_slot_active(line);
+    } else if (strncmp(line, "CONFIG|", 7) == 0) {
+        parse_config_message(line);
+    } else if (strncmp(line, "MESSAGE|", 8) == 0) {
+        parse_message(line);
+        if (client_mode == MODE_INTERACTIVE && strstr(line, "|text=FRAG|") == NULL) {
+            printf("Enter message: ");
+            fflush(stdout);
+        }
+    } else if (strncmp(line, "COLLISION|", 10) == 0) {
+        parse_collision(line);
+        if (client_mode == MODE_INTERACTIVE && strstr(line, "|frag=") == NULL) {
+            printf("Enter message: ");
+            fflush(stdout);
+        }
+    } else {
+        if (client_mode == MODE_INTERACTIVE) {
+            printf("\n%s\n", line);
+            printf("Enter message: ");
+            fflush(stdout);
+        }
+    }
+}
+
+// detect dead Wi-Fi links within a few seconds instead of TCP's default hours
+void set_keepalive(int sd) {
+    int on = 1, idle = 1, interval = 1, count = 3;
+    setsockopt(sd, SOL_SOCKET, SO_KEEPALIVE, &on, sizeof(on));
+    setsockopt(sd, IPPROTO_TCP, TCP_KEEPIDLE, &idle, sizeof(idle));
+    setsockopt(sd, IPPROTO_TCP, TCP_KEEPINTVL, &interval, sizeof(interval));
+    setsockopt(sd, IPPROTO_TCP, TCP_KEEPCNT, &count, sizeof(count));
+    
+    // keepalive stays quiet while data is unacked, this bounds that case
+    int user_timeout = USER_TIMEOUT_MS;
+    setsockopt(sd, IPPROTO_TCP, TCP_USER_TIMEOUT, &user_timeout, sizeof(user_timeout));
+}
+
+// reconnect with exponential backoff and ask the server to resume our session
+// queued messages stay in msg_queue and go out once our slot comes around again
+int reconnect_to_server() {
+    int delay_ms = 0;
+    
+    while (running) {
+        if (delay_ms > 0) {
+            usleep(delay_ms * 1000);
+        }
+        delay_ms = (delay_ms == 0) ? RECONNECT_MIN_MS : delay_ms * 2;
+        if (delay_ms > RECONNECT_MAX_MS) {
+            delay_ms = RECONNECT_MAX_MS;
+        }
+        
+        int sd = socket(AF_INET, SOCK_STREAM, 0);
+        if (sd < 0) {
+            continue;
+        }
+        if (connect(sd, (struct sockaddr *)&server_addr, sizeof(server_addr)) < 0) {
+            close(sd);
+            continue;
+        }
+        set_keepalive(sd);
+        
+        pthread_mutex_lock(&tdma_info.lock);
+        tdma_info.my_turn = 0;
+        tdma_info.credits = -1;
+        pthread_mutex_unlock(&tdma_info.lock);
+        
+        if (resume_token[0] != '\0') {
+            char resume_msg[64];
+            snprintf(resume_msg, sizeof(resume_msg), "RESUME|token=%s\n", resume_token);
+            resuming = 1;
+            send(sd, resume_msg, strlen(resume_msg), 0);
+        }
+        
+        sock = sd;
+        connected = 1;
+        return 0;
+    }
+    return -1;
+}
+
+// connect to a server on this host and map the rings it hands us
+int connect_local(const char *path) {
+    struct sockaddr_un addr;
+    
+    if ((sock = socket(AF_UNIX, SOCK_STREAM, 0)) < 0) {
+        return -1;
+    }
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strncpy(addr.sun_path, path, sizeof(addr.sun_path) - 1);
+    if (connect(sock, (struct sockaddr *)&addr, sizeof(addr)) < 0) {
+        return -1;
+    }
+    
+    // memfd, server doorbell, our doorbell arrive as SCM_RIGHTS
+    int fds[3];
+    char cmsg_buf[CMSG_SPACE(sizeof(fds))];
+    char dummy;
+    struct iovec iov = {&dummy, 1};
+    struct msghdr msg;
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = cmsg_buf;
+    msg.msg_controllen = sizeof(cmsg_buf);
+    
+    if (recvmsg(sock, &msg, 0) <= 0) {
+        return -1;
+    }
+    struct cmsghdr *cmsg = CMSG_FIRSTHDR(&msg);
+    if (cmsg == NULL || cmsg->cmsg_type != SCM_RIGHTS || cmsg->cmsg_len != CMSG_LEN(sizeof(fds))) {
+        return -1;
+    }
+    memcpy(fds, CMSG_DATA(cmsg), sizeof(fds));
+    
+    local_shm = mmap(NULL, sizeof(ShmRegion), PROT_READ | PROT_WRITE, MAP_SHARED, fds[0], 0);
+    close(fds[0]);
+    if (local_shm == MAP_FAILED) {
+        local_shm = NULL;
+        return -1;
+    }
+    local_doorbell_tx = fds[1];
+    local_doorbell_rx = fds[2];
+    return 0;
+}
+
+// send over TCP or into the shared-memory ring
+int transport_send(const char *data, int len) {
+    if (local_shm == NULL) {
+        return send(sock, data, len, 0);
+    }
+    
+    // wait for the server to make room
+    while (!shm_ring_write(&local_shm->to_server, data, len)) {
+        if (!running) {
+            return -1;
+        }
+        usleep(1000);
+    }
+    uint64_t one = 1;
+    if (write(local_doorbell_tx, &one, sizeof(one)) < 0) {
+        // counter saturated, the server still sees the data in the ring
+    }
+    return len;
+}
+
+// blocking read from TCP or the shared-memory ring, 0 when the server is gone
+int transport_recv(char *buf, int max) {
+    if (local_shm == NULL) {
+        return read(sock, buf, max);
+    }
+    
+    while (1) {
+        int n = shm_ring_read(&local_shm->to_client, buf, max);
+        if (n > 0) {
+            return n;
+        }
+        
+        // the doorbell count survives until read, so a write between the
+        // ring check and poll still wakes us
+        struct pollfd fds[2] = {
+            {local_doorbell_rx, POLLIN, 0},
+            {sock, POLLIN, 0}
+        };
+        if (poll(fds, 2, -1) < 0) {
+            return -1;
+        }
+        if (fds[1].revents) {
+            return 0;  // handshake socket closed
+        }
+        uint64_t count;
+        if (read(local_doorbell_rx, &count, sizeof(count)) < 0) {
+            return -1;
+        }
+    }
+}
+
 // processes teh incoming traffic from server
 void *receive_messages(void *arg) {
-    char buffer[BUFFER_SIZE];
+    char buffer[2 * BUFFER_SIZE];
+    int buffered = 0;
     int valread;
     
     // while on
     while (running) {
-        memset(buffer, 0, BUFFER_SIZE);
-        valread = read(sock, buffer, BUFFER_SIZE - 1);
+        valread = transport_recv(buffer + buffered, sizeof(buffer) - 1 - buffered);
         
         if (valread > 0) {
-            buffer[valread] = '\0';
+            buffered += valread;
             
-            // Parse different message types
-            if (strncmp(buffer, "WELCOME|", 8) == 0) {
-                parse_welcome_message(buffer);
-            } else if (strncmp(buffer, "TDMA_INFO|", 10) == 0) {
-                parse_tdma_info(buffer);
-            } else if (strncmp(buffer, "SLOT_ACTIVE|", 12) == 0) {
-                parse_slot_active(buffer);
-            } else if (strncmp(buffer, "MESSAGE|", 8) == 0) {
-                parse_message(buffer);
-                if (client_mode == MODE_INTERACTIVE) {
-                    printf("Enter message: ");
-                    fflush(stdout);
-                }
-            } else if (strncmp(buffer, "COLLISION|", 10) == 0) {
-                parse_collision(buffer);
-                if (client_mode == MODE_INTERACTIVE) {
-                    printf("Enter message: ");
-                    fflush(stdout);
-                }
-            } else {
-                if (client_mode == MODE_INTERACTIVE) {
-                    printf("\n%s", buffer);
-                    printf("Enter message: ");
-                    fflush(stdout);
+            // split the stream into lines, several can arrive in one read
+            int start = 0;
+            for (int pos = 0; pos < buffered; pos++) {
+                if (buffer[pos] == '\n') {
+                    buffer[pos] = '\0';
+                    if (pos > start) {
+                        handle_server_line(buffer + start);
+                    }
+                    start = pos + 1;
                 }
             }
-        } else if (valread == 0) {
+            
+            // line longer than the buffer, handle what we have
+            if (start == 0 && buffered == (int)sizeof(buffer) - 1) {
+                buffer[buffered] = '\0';
+                handle_server_line(buffer);
+                start = buffered;
+            }
+            
+            buffered -= start;
+            if (buffered > 0 && start > 0) {
+                memmove(buffer, buffer + start, buffered);
+            }
+        } else if (local_shm != NULL) {
+            // a local server going away is not a flaky link, nothing to resume
             printf("\nServer disconnected\n");
             running = 0;
             break;
+        } else if (valread == 0 || errno != EINTR) {
+            printf("\nServer disconnected, reconnecting...\n");
+            connected = 0;
+            disconnect_time = get_time_ms();
+            close(sock);
+            buffered = 0;
+            
+            if (reconnect_to_server() < 0) {
+                break;
+            }
         }
     }
     
@@ -264,19 +957,70 @@ void *receive_messages(void *arg) {
 // sends messages during our TDMA time slot
 void *transmit_messages(void *arg) {
     char msg[BUFFER_SIZE];
+    size_t len = 0;
+    int have_msg = 0;  // message taken from the queue but not sent yet
+    size_t tag_len = 0;  // length of the SYNC| prefix on msg, 0 if untagged
+    long long tagged_turn = 0;  // turn_start of the last turn we sent in
     
     while (running) {
+        // this thread never blocks for long, so it picks up SIGHUP reloads
+        if (reload_requested) {
+            reload_config();
+        }
+        
         // Check if it's our turn to transmit
         pthread_mutex_lock(&tdma_info.lock);
-        int can_transmit = tdma_info.my_turn;
+        int can_transmit = tdma_info.my_turn && tdma_info.credits != 0 &&
+            get_time_ms() - tdma_info.turn_start < tdma_info.slot_duration_ms - tdma_info.stop_margin_ms;
+        long long turn_start = tdma_info.turn_start;
+        int backlog = tdma_info.backlog_at_start;
         pthread_mutex_unlock(&tdma_info.lock);
         
-        if (can_transmit && msg_queue.count > 0) {
-            if (dequeue_message(msg)) {
-                if (send(sock, msg, strlen(msg), 0) < 0) {
-                    printf("\nSend failed\n");
-                    running = 0;
-                    break;
+        if (can_transmit && connected && (have_msg || msg_queue.count > 0)) {
+            if (!have_msg && dequeue_message(msg)) {
+                // the server splits messages on newlines
+                len = strlen(msg);
+                if (len > 0 && msg[len - 1] != '\n' && len < BUFFER_SIZE - 1) {
+                    msg[len++] = '\n';
+                    msg[len] = '\0';
+                }
+                
+                // flag the first line of a turn that began with a backlog so
+                // the server can use its arrival time as a lag sample
+                tag_len = 0;
+                if (turn_start != tagged_turn) {
+                    tagged_turn = turn_start;
+                    if (backlog && len + SYNC_TAG_LEN < BUFFER_SIZE) {
+                        memmove(msg + SYNC_TAG_LEN, msg, len + 1);
+                        memcpy(msg, SYNC_TAG, SYNC_TAG_LEN);
+                        len += SYNC_TAG_LEN;
+                        tag_len = SYNC_TAG_LEN;
+                    }
+                }
+                have_msg = 1;
+            }
+            
+            if (have_msg) {
+                // each message spends one of the credits granted for this slot
+                pthread_mutex_lock(&tdma_info.lock);
+                if (tdma_info.credits > 0) {
+                    tdma_info.credits--;
+                }
+                pthread_mutex_unlock(&tdma_info.lock);
+                
+                if (transport_send(msg, len) < 0) {
+                    // keep the message and wake the receive thread to reconnect
+                    printf("\nSend failed, retrying after reconnect\n");
+                    shutdown(sock, SHUT_RDWR);
+                    usleep(5000);
+                    continue;
+                }
+                have_msg = 0;
+                
+                if (strncmp(msg + tag_len, "FRAG|", 5) == 0) {
+                    pthread_mutex_lock(&bulk_stats.lock);
+                    bulk_stats.fragments_sent++;
+                    pthread_mutex_unlock(&bulk_stats.lock);
                 }
                 
                 // Update statistics in test mode
@@ -294,13 +1038,138 @@ void *transmit_messages(void *arg) {
     return NULL;
 }
 
-// generate message seuqnce for test mode eveery 33 ms
+// queue one fragment, waiting while the queue is full
+int queue_fragment(unsigned int msg_id, const char *data, unsigned int offset, unsigned int total) {
+    static const char hex_digits[] = "0123456789abcdef";
+    unsigned int len = total - offset;
+    if (len > FRAG_CHUNK) {
+        len = FRAG_CHUNK;
+    }
+    
+    // wait for space, the transmit thread drains the queue in our slot
+    char *slot;
+    while ((slot = queue_reserve(FRAG_MSG_MAX)) == NULL && running) {
+        usleep(5000);
+    }
+    if (slot == NULL) {
+        return 0;
+    }
+    
+    int n = snprintf(slot, FRAG_MSG_MAX + 1, "FRAG|id=%u|off=%u|total=%u|data=",
+                     msg_id, offset, total);
+    for (unsigned int i = 0; i < len; i++) {
+        unsigned char b = (unsigned char)data[offset + i];
+        slot[n++] = hex_digits[b >> 4];
+        slot[n++] = hex_digits[b & 0x0f];
+    }
+    slot[n++] = '\n';
+    queue_commit(n);
+    return len;
+}
+
+// split a payload into fragments and queue them for our slots
+// blocks until everything is sent, so any size up to MAX_TRANSFER_BYTES works
+void send_bulk(const char *data, unsigned int total) {
+    unsigned int msg_id = next_msg_id++;
+    long long start_time = get_time_ms();
+    unsigned int next_report = total / 4;
+    
+    pthread_mutex_lock(&bulk_stats.lock);
+    bulk_tx_id = msg_id;
+    bulk_resend_count = 0;
+    pthread_mutex_unlock(&bulk_stats.lock);
+    
+    printf("[BULK] Sending transfer %u: %u bytes in %u fragments\n",
+           msg_id, total, (total + FRAG_CHUNK - 1) / FRAG_CHUNK);
+    
+    for (unsigned int offset = 0; offset < total && running; offset += FRAG_CHUNK) {
+        int len = queue_fragment(msg_id, data, offset, total);
+        
+        pthread_mutex_lock(&bulk_stats.lock);
+        bulk_stats.fragments_queued++;
+        bulk_stats.bytes_sent += len;
+        pthread_mutex_unlock(&bulk_stats.lock);
+        
+        if (offset + len >= next_report && offset + len < total) {
+            printf("[BULK] Transfer %u: %u/%u bytes queued\n", msg_id, offset + len, total);
+            next_report += total / 4;
+        }
+    }
+    
+    // resend anything the server dropped until the queue stays empty for a
+    // couple of slots, so late COLLISION replies are still picked up
+    long long idle_since = 0;
+    while (running) {
+        pthread_mutex_lock(&bulk_stats.lock);
+        int resend = bulk_resend_count > 0;
+        unsigned int offset = resend ? bulk_resend[--bulk_resend_count] : 0;
+        if (resend) {
+            bulk_stats.fragments_resent++;
+        }
+        pthread_mutex_unlock(&bulk_stats.lock);
+        
+        if (resend) {
+            queue_fragment(msg_id, data, offset, total);
+            idle_since = 0;
+        } else if (msg_queue.count > 0) {
+            idle_since = 0;
+            usleep(5000);
+        } else if (idle_since == 0) {
+            idle_since = get_time_ms();
+        } else if (get_time_ms() - idle_since > 2 * tdma_info.slot_duration_ms) {
+            break;
+        } else {
+            usleep(5000);
+        }
+    }
+    
+    pthread_mutex_lock(&bulk_stats.lock);
+    bulk_tx_id = 0;
+    bulk_stats.transfers_sent++;
+    unsigned long resent = bulk_stats.fragments_resent;
+    pthread_mutex_unlock(&bulk_stats.lock);
+    
+    long long elapsed = get_time_ms() - start_time;
+    printf("[BULK] Transfer %u sent: %u bytes in %lld ms (%.1f KB/s, %lu fragments resent so far)\n",
+           msg_id, total, elapsed,
+           elapsed > 0 ? (total / 1024.0) / (elapsed / 1000.0) : 0.0, resent);
+}
+
+// read a file and send it as a bulk transfer
+void send_file(const char *path) {
+    FILE *fp = fopen(path, "rb");
+    if (fp == NULL) {
+        printf("Could not open %s\n", path);
+        return;
+    }
+    
+    size_t total = fread(bulk_tx_buf, 1, MAX_TRANSFER_BYTES, fp);
+    int truncated = !feof(fp);
+    fclose(fp);
+    
+    if (truncated) {
+        printf("%s is larger than %d bytes\n", path, MAX_TRANSFER_BYTES);
+        return;
+    }
+    if (total == 0) {
+        printf("%s is empty\n", path);
+        return;
+    }
+    if (server_max_message > 0 && server_max_message < FRAG_MSG_MAX) {
+        printf("The server limits messages to %d bytes, fragments need %d\n",
+               server_max_message, FRAG_MSG_MAX);
+        return;
+    }
+    
+    send_bulk(bulk_tx_buf, total);
+}
+
+// generate message seuqnce for test mode eveery 33 ms (test_interval_ms)
 void *test_message_generator(void *arg) {
     unsigned long sequence = 0;
-    char test_msg[BUFFER_SIZE];
     long long last_send_time = get_time_ms();
     
-    printf("[TEST MODE] Starting automatic message generation every %d ms\n", TEST_INTERVAL_MS);
+    printf("[TEST MODE] Starting automatic message generation every %d ms\n", config.test_interval_ms);
     printf("[TEST MODE] Messages will be queued and sent during assigned TDMA slots\n");
     printf("[TEST MODE] Press Ctrl+C to stop\n\n");
     
@@ -310,12 +1179,32 @@ void *test_message_generator(void *arg) {
     while (running) {
         long long current_time = get_time_ms();
         
+        // don't queue more than the server granted for our next slot, the
+        // rest would only wait in the queue and add latency
+        pthread_mutex_lock(&tdma_info.lock);
+        int granted = tdma_info.granted_credits;
+        pthread_mutex_unlock(&tdma_info.lock);
+        
+        if (current_time - last_send_time >= config.test_interval_ms &&
+            granted >= 0 && msg_queue.count >= granted) {
+            pthread_mutex_lock(&test_stats.lock);
+            test_stats.messages_throttled++;
+            pthread_mutex_unlock(&test_stats.lock);
+            last_send_time = current_time;
+        }
+        
         // Check if it's time to generate a new test message
-        if (current_time - last_send_time >= TEST_INTERVAL_MS) {
-            snprintf(test_msg, BUFFER_SIZE, "[TEST] Client %d, Seq %lu, Time %lld\n", 
-                     client_id, sequence++, current_time);
-            
-            if (enqueue_message(test_msg)) {
+        if (current_time - last_send_time >= config.test_interval_ms) {
+            // format straight into the queue instead of a staging buffer
+            char *slot = queue_reserve(TEST_MSG_MAX);
+            if (slot != NULL) {
+                int len = snprintf(slot, TEST_MSG_MAX + 1, "[TEST] Client %d, Seq %lu, Time %lld\n", 
+                                   client_id, sequence++, current_time);
+                if (len > TEST_MSG_MAX) {
+                    len = TEST_MSG_MAX;
+                }
+                queue_commit(len);
+                
                 pthread_mutex_lock(&test_stats.lock);
                 test_stats.messages_queued++;
                 pthread_mutex_unlock(&test_stats.lock);
@@ -341,12 +1230,17 @@ void *statistics_reporter(void *arg) {
         pthread_mutex_lock(&test_stats.lock);
         unsigned long queued = test_stats.messages_queued;
         unsigned long sent = test_stats.messages_sent;
+        unsigned long throttled = test_stats.messages_throttled;
         pthread_mutex_unlock(&test_stats.lock);
         
+        pthread_mutex_lock(&tdma_info.lock);
+        int granted = tdma_info.granted_credits;
+        pthread_mutex_unlock(&tdma_info.lock);
+        
         long long elapsed = (get_time_ms() - start_time) / 1000;  // seconds
         
-        printf("[TEST STATS] Runtime: %lld s | Queued: %lu | Sent: %lu | Queue: %d\n",
-               elapsed, queued, sent, msg_queue.count);
+        printf("[TEST STATS] Runtime: %lld s | Queued: %lu | Sent: %lu | Throttled: %lu | Credits: %d | Queue: %d (%d/%d bytes)\n",
+               elapsed, queued, sent, throttled, granted, msg_queue.count, msg_queue.used, msg_queue.capacity);
     }
     
     return NULL;
@@ -359,36 +1253,86 @@ void display_status() {
     printf("Your Slot: %d\n", tdma_info.my_slot);
     printf("Current Slot: %d\n", tdma_info.current_slot);
     printf("Your Turn: %s\n", tdma_info.my_turn ? "YES" : "NO");
-    printf("Queued Messages: %d\n", msg_queue.count);
+    printf("Credits: %d of %d\n", tdma_info.credits, tdma_info.granted_credits);
+    printf("Slot End Margin: %d ms\n", tdma_info.stop_margin_ms);
+    printf("Queued Messages: %d (%d/%d bytes)\n", msg_queue.count, msg_queue.used, msg_queue.capacity);
     pthread_mutex_unlock(&tdma_info.lock);
     
     if (client_mode == MODE_TEST) {
         pthread_mutex_lock(&test_stats.lock);
         printf("Test Messages Queued: %lu\n", test_stats.messages_queued);
         printf("Test Messages Sent: %lu\n", test_stats.messages_sent);
+        printf("Test Messages Throttled: %lu\n", test_stats.messages_throttled);
         pthread_mutex_unlock(&test_stats.lock);
     }
+    
+    pthread_mutex_lock(&bulk_stats.lock);
+    printf("Bulk Sent: %lu transfers, %lu/%lu fragments (%lu resent), %llu bytes\n",
+           bulk_stats.transfers_sent, bulk_stats.fragments_sent,
+           bulk_stats.fragments_queued, bulk_stats.fragments_resent, bulk_stats.bytes_sent);
+    printf("Bulk Received: %lu transfers, %lu dropped, %lu fragments, %llu bytes\n",
+           bulk_stats.transfers_received, bulk_stats.transfers_dropped,
+           bulk_stats.fragments_received, bulk_stats.bytes_received);
+    pthread_mutex_unlock(&bulk_stats.lock);
     printf("==================\n");
 }
 
 int main(int argc, char *argv[]) {
-    struct sockaddr_in serv_addr;
     pthread_t recv_thread, tx_thread, test_gen_thread, stats_thread;
     char buffer[BUFFER_SIZE];
     
-    // Setup clean exit 
+    // Setup clean exit, a dropped link shows up as a send error instead of SIGPIPE
     signal(SIGINT, signal_handler);
+    signal(SIGPIPE, SIG_IGN);
+    signal(SIGHUP, reload_handler);
+    
+    // optional settings after the server and mode, the command line wins over the
+    // file and is checked the same way as its lines
+    const char *cli_keys[] = {"port", "test_interval_ms", "queue_bytes"};
+    const char *cli_values[3] = {NULL, NULL, NULL};
+    int bad_args = (argc < 3);
+    for (int i = 3; i < argc && !bad_args; i++) {
+        if (strcmp(argv[i], "-c") == 0 && i + 1 < argc) {
+            config_path = argv[++i];
+        } else if (strcmp(argv[i], "-p") == 0 && i + 1 < argc) {
+            cli_values[0] = argv[++i];
+        } else if (strcmp(argv[i], "-i") == 0 && i + 1 < argc) {
+            cli_values[1] = argv[++i];
+        } else if (strcmp(argv[i], "-q") == 0 && i + 1 < argc) {
+            cli_values[2] = argv[++i];
+        } else {
+            bad_args = 1;
+        }
+    }
     
-    //error checking for correct number of args - server ip, mode required
-    if (argc != 3) {
-        printf("Usage: %s <server_ip> <mode>\n", argv[0]);
+    //error checking for args - server ip, mode required
+    if (bad_args) {
+        printf("Usage: %s <server_ip | %s> <mode> [-c config_file] [-p port] [-i interval_ms] [-q queue_bytes]\n",
+               argv[0], SHM_SOCKET_PATH);
         printf("Modes:\n");
         printf("  1 - Interactive mode (manual message entry)\n");
-        printf("  2 - Test mode (automatic messages every 33ms)\n");
+        printf("  2 - Test mode (automatic messages every 33ms, see -i)\n");
         printf("Example: %s 192.168.25.1 1\n", argv[0]);
+        printf("A socket path connects over shared memory to a server on this host started with -l\n");
+        printf("-c reads key=value settings (port, test_interval_ms, queue_bytes), kill -HUP reloads it\n");
+        printf("-q is between %d and %d bytes\n", MIN_QUEUE_BYTES, QUEUE_BYTES);
         return -1;
     }
     
+    if (config_path != NULL) {
+        int errors = config_load(config_path, apply_client_setting, &config);
+        if (errors != 0) {
+            printf("Config file %s %s\n", config_path, errors < 0 ? "could not be read" : "has errors");
+            return -1;
+        }
+    }
+    for (int k = 0; k < 3; k++) {
+        if (cli_values[k] != NULL && apply_client_setting(&config, cli_keys[k], cli_values[k]) != 0) {
+            printf("Invalid %s: %s\n", cli_keys[k], cli_values[k]);
+            return -1;
+        }
+    }
+    
     // parse arguments to determine interactive or test mode function
     int mode = atoi(argv[2]);
     if (mode == 1) {
@@ -403,36 +1347,48 @@ int main(int argc, char *argv[]) {
     init_message_queue();
     init_tdma_info();
     init_test_stats();
+    init_bulk();
     
-    // Create socket
-    if ((sock = socket(AF_INET, SOCK_STREAM, 0)) < 0) {
-        printf("Socket creation error\n");
-        return -1;
-    }
-    
-    //socket settings - port and IP of TCP server
-    serv_addr.sin_family = AF_INET;
-    serv_addr.sin_port = htons(8080);
-    
-    // Convert IPv4 address from text to binary
-    if (inet_pton(AF_INET, argv[1], &serv_addr.sin_addr) <= 0) {
-        printf("Invalid address / Address not supported\n");
-        return -1;
-    }
-    
-    // Connect to server
-    printf("Connecting to TDMA server at %s:8080...\n", argv[1]);
-    if (connect(sock, (struct sockaddr *)&serv_addr, sizeof(serv_addr)) < 0) {
-        printf("Connection failed. Make sure the server is running.\n");
-        return -1;
+    if (argv[1][0] == '/') {
+        // a path means the server runs on this host, use shared memory
+        printf("Connecting to local TDMA server at %s...\n", argv[1]);
+        if (connect_local(argv[1]) < 0) {
+            printf("Connection failed. Make sure the server is running with -l.\n");
+            return -1;
+        }
+    } else {
+        // Create socket
+        if ((sock = socket(AF_INET, SOCK_STREAM, 0)) < 0) {
+            printf("Socket creation error\n");
+            return -1;
+        }
+        
+        //socket settings - port and IP of TCP server
+        server_addr.sin_family = AF_INET;
+        server_addr.sin_port = htons(config.port);
+        
+        // Convert IPv4 address from text to binary
+        if (inet_pton(AF_INET, argv[1], &server_addr.sin_addr) <= 0) {
+            printf("Invalid address / Address not supported\n");
+            return -1;
+        }
+        
+        // Connect to server
+        printf("Connecting to TDMA server at %s:%d...\n", argv[1], config.port);
+        if (connect(sock, (struct sockaddr *)&server_addr, sizeof(server_addr)) < 0) {
+            printf("Connection failed. Make sure the server is running.\n");
+            return -1;
+        }
+        set_keepalive(sock);
     }
+    connected = 1;
     
     printf("Server connection succesful.\n");
     
     if (client_mode == MODE_INTERACTIVE) {
         printf("Mode: INTERACTIVE - Manual message entry\n");
     } else {
-        printf("Mode: TEST - Automatic message generation (33ms interval)\n");
+        printf("Mode: TEST - Automatic message generation (%dms interval)\n", config.test_interval_ms);
     }
     
     printf("Waiting for TDMA slot assignment.\n");
@@ -477,6 +1433,7 @@ int main(int argc, char *argv[]) {
         // Client-client interactive mode
         printf("\n=== TDMA Client Ready ===\n");
         printf("Type 'status' to see TDMA status\n");
+        printf("Type 'sendfile <path>' to send a file in fragments\n");
         printf("Type your message and press Enter to queue it\n");
         printf("Messages will be sent automatically during your time slot\n");
         printf("Press Ctrl+C to exit\n\n");
@@ -509,6 +1466,18 @@ int main(int argc, char *argv[]) {
                 continue;
             }
             
+            // Check for bulk file transfer command
+            if (strncmp(buffer, "sendfile ", 9) == 0) {
+                send_file(buffer + 9);
+                continue;
+            }
+            
+            // the server would drop it anyway
+            if (server_max_message > 0 && (int)strlen(buffer) > server_max_message) {
+                printf("Message is longer than the server's limit of %d bytes\n", server_max_message);
+                continue;
+            }
+            
             // Queue the message for transmission
             if (enqueue_message(buffer)) {
                 //Buffer not full, notify user of message queing 
@@ -534,6 +1503,7 @@ int main(int argc, char *argv[]) {
     pthread_mutex_destroy(&msg_queue.lock);
     pthread_mutex_destroy(&tdma_info.lock);
     pthread_mutex_destroy(&test_stats.lock);
+    pthread_mutex_destroy(&bulk_stats.lock);
     close(sock);
     
     return 0;
@@ -0,0 +1,64 @@
+#ifndef CONFIG_H
+#define CONFIG_H
+
+#include <stdio.h>
+#include <string.h>
+
+// key=value configuration files shared by server and client
+// blank lines and lines starting with # are ignored, whitespace around keys
+// and values is trimmed
+
+// applies one setting, returns 0 if the key and value were accepted
+typedef int (*ConfigApply)(void *target, const char *key, const char *value);
+
+static char *config_trim(char *text) {
+    while (*text == ' ' || *text == '\t') {
+        text++;
+    }
+    char *end = text + strlen(text);
+    while (end > text && (end[-1] == ' ' || end[-1] == '\t' || end[-1] == '\n' || end[-1] == '\r')) {
+        *--end = '\0';
+    }
+    return text;
+}
+
+// read path and hand every setting to apply, returns the number of bad lines
+// or -1 if the file could not be opened
+static int config_load(const char *path, ConfigApply apply, void *target) {
+    char line[256];
+    int line_number = 0;
+    int errors = 0;
+    FILE *fp = fopen(path, "r");
+
+    if (fp == NULL) {
+        return -1;
+    }
+
+    while (fgets(line, sizeof(line), fp) != NULL) {
+        line_number++;
+        char *text = config_trim(line);
+        if (*text == '\0' || *text == '#') {
+            continue;
+        }
+
+        char *equals = strchr(text, '=');
+        if (equals == NULL) {
+            printf("%s:%d: expected key=value\n", path, line_number);
+            errors++;
+            continue;
+        }
+        *equals = '\0';
+        char *key = config_trim(text);
+        char *value = config_trim(equals + 1);
+
+        if (apply(target, key, value) != 0) {
+            printf("%s:%d: invalid setting %s=%s\n", path, line_number, key, value);
+            errors++;
+        }
+    }
+
+    fclose(fp);
+    return errors;
+}
+
+#endif
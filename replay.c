@@ -0,0 +1,338 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <arpa/inet.h>
+#include <sys/socket.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <errno.h>
+#include "capture.h"
+
+#define PORT 8080  // default, the server may run elsewhere with -p
+#define MAX_REPLAY_CLIENTS 256  // one per possible client index in a capture
+#define TURN_TIMEOUT_US 2000000  // longest wait for a client's slot before sending anyway
+
+// structure for one replayed client connection
+typedef struct {
+    int socket;
+    int line_pos;       // position in the current reply line
+    char line_head[32]; // start of the current reply line
+    int my_turn;              // the server says this connection's slot is running
+    unsigned long turns;      // SLOT_ACTIVE|your_turn=1 lines received
+    unsigned long used_turn;  // turn the current burst is being sent in
+    long long turn_start_us;  // when the latest turn began here
+    long long rec_slot_us;    // recorded start of this client's latest slot, -1 before one
+    long long burst_slot_us;  // recorded slot start the current burst belongs to
+    int burst_aligned;        // the current burst found its slot on the server
+} ReplayClient;
+
+// totals printed when the replay finishes
+typedef struct {
+    unsigned long accepts;
+    unsigned long disconnects;
+    unsigned long payloads;
+    unsigned long slots;
+    unsigned long long payload_bytes;
+    unsigned long long reply_bytes;
+    unsigned long replies_message;
+    unsigned long replies_collision;
+    unsigned long late_events;  // events sent more than 1 ms after their target time
+    unsigned long recorded_outside;  // payloads the server read outside the sender's slot
+    unsigned long unaligned;  // payloads sent without waiting for the sender's slot
+} ReplayStats;
+
+ReplayClient replay_clients[MAX_REPLAY_CLIENTS];
+ReplayStats stats;
+
+// Get monotonic time in microseconds
+long long get_monotonic_us() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long long)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+// count server replies by type, they can arrive split across reads
+void scan_replies(ReplayClient *rc, const char *data, int len) {
+    for (int i = 0; i < len; i++) {
+        if (rc->line_pos < (int)sizeof(rc->line_head)) {
+            rc->line_head[rc->line_pos] = data[i];
+        }
+        rc->line_pos++;
+
+        if (data[i] == '\n') {
+            if (rc->line_pos > 10 && memcmp(rc->line_head, "COLLISION|", 10) == 0) {
+                stats.replies_collision++;
+            } else if (rc->line_pos > 8 && memcmp(rc->line_head, "MESSAGE|", 8) == 0) {
+                stats.replies_message++;
+            } else if (rc->line_pos > 23 && memcmp(rc->line_head, "SLOT_ACTIVE|your_turn=", 22) == 0) {
+                // every your_turn=1 line starts a new occurrence of our slot
+                rc->my_turn = rc->line_head[22] == '1';
+                if (rc->my_turn) {
+                    rc->turns++;
+                    rc->turn_start_us = get_monotonic_us();
+                }
+            }
+            rc->line_pos = 0;
+        }
+    }
+}
+
+// read whatever the server sent to our connections without blocking
+void drain_replies() {
+    char buffer[4096];
+
+    for (int i = 0; i < MAX_REPLAY_CLIENTS; i++) {
+        ReplayClient *rc = &replay_clients[i];
+        if (rc->socket < 0) {
+            continue;
+        }
+
+        int n;
+        while ((n = recv(rc->socket, buffer, sizeof(buffer), MSG_DONTWAIT)) > 0) {
+            stats.reply_bytes += n;
+            scan_replies(rc, buffer, n);
+        }
+        if (n == 0) {
+            printf("Server closed replayed client %d\n", i + 1);
+            close(rc->socket);
+            rc->socket = -1;
+        }
+    }
+}
+
+// wait until the target time while still reading server replies
+void wait_until(long long target_us) {
+    while (1) {
+        drain_replies();
+        long long remaining = target_us - get_monotonic_us();
+        if (remaining <= 0) {
+            return;
+        }
+        usleep(remaining > 1000 ? 1000 : remaining);
+    }
+}
+
+// wait for a slot of this connection that no earlier burst was sent in and
+// that has not yet run past offset_us, the time into the slot of the burst
+int wait_for_turn(ReplayClient *rc, long long offset_us) {
+    long long deadline = get_monotonic_us() + TURN_TIMEOUT_US;
+    while (rc->socket >= 0 && get_monotonic_us() < deadline) {
+        if (rc->my_turn && rc->turns > rc->used_turn) {
+            rc->used_turn = rc->turns;
+            if (rc->turn_start_us + offset_us >= get_monotonic_us() - 1000) {
+                return 0;
+            }
+        }
+        usleep(200);
+        drain_replies();
+    }
+    return -1;
+}
+
+int connect_to_server(struct sockaddr_in *serv_addr) {
+    int sd = socket(AF_INET, SOCK_STREAM, 0);
+    if (sd < 0) {
+        return -1;
+    }
+    if (connect(sd, (struct sockaddr *)serv_addr, sizeof(*serv_addr)) < 0) {
+        close(sd);
+        return -1;
+    }
+    return sd;
+}
+
+int main(int argc, char *argv[]) {
+    struct sockaddr_in serv_addr;
+    struct stat st;
+    double speed = 1.0;
+    int port = PORT;
+
+    //error checking for args - capture file and server ip required
+    if (argc < 3 || argc > 5) {
+        printf("Usage: %s <capture_file> <server_ip> [speed] [port]\n", argv[0]);
+        printf("  speed 1 replays at recorded timing, 10 is ten times faster,\n");
+        printf("  0 sends every event as fast as possible\n");
+        printf("  port defaults to %d, use the server's -p value otherwise\n", PORT);
+        printf("Example: %s session.cap 127.0.0.1 4 9000\n", argv[0]);
+        return -1;
+    }
+    if (argc >= 4) {
+        speed = atof(argv[3]);
+        if (speed < 0) {
+            printf("Invalid speed\n");
+            return -1;
+        }
+    }
+    if (argc == 5) {
+        port = atoi(argv[4]);
+        if (port <= 0 || port > 65535) {
+            printf("Invalid port\n");
+            return -1;
+        }
+    }
+
+    serv_addr.sin_family = AF_INET;
+    serv_addr.sin_port = htons(port);
+    if (inet_pton(AF_INET, argv[2], &serv_addr.sin_addr) <= 0) {
+        printf("Invalid address / Address not supported\n");
+        return -1;
+    }
+
+    // map the whole capture, records are read straight out of the mapping
+    int fd = open(argv[1], O_RDONLY);
+    if (fd < 0 || fstat(fd, &st) < 0) {
+        perror("Capture file open failed");
+        return -1;
+    }
+    if (st.st_size < CAPTURE_MAGIC_LEN) {
+        printf("Capture file too short\n");
+        return -1;
+    }
+    const char *map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (map == MAP_FAILED) {
+        perror("mmap failed");
+        return -1;
+    }
+    close(fd);
+
+    if (memcmp(map, CAPTURE_MAGIC, CAPTURE_MAGIC_LEN) != 0) {
+        printf("Not a TDMA capture file\n");
+        return -1;
+    }
+
+    for (int i = 0; i < MAX_REPLAY_CLIENTS; i++) {
+        replay_clients[i].socket = -1;
+        replay_clients[i].line_pos = 0;
+        replay_clients[i].rec_slot_us = -1;
+    }
+
+    printf("=== TDMA Replay ===\n");
+    printf("Capture: %s (%lld bytes)\n", argv[1], (long long)st.st_size);
+    printf("Server: %s:%d\n", argv[2], port);
+    if (speed > 0) {
+        printf("Speed: %.2fx\n\n", speed);
+    } else {
+        printf("Speed: unthrottled\n\n");
+    }
+
+    long long start = get_monotonic_us();
+    long long shift = 0;  // how far the replay runs behind the recording after slot waits
+    long long last_event_us = 0;
+    size_t pos = CAPTURE_MAGIC_LEN;
+
+    while (pos + sizeof(CaptureRecord) <= (size_t)st.st_size) {
+        CaptureRecord rec;
+        memcpy(&rec, map + pos, sizeof(rec));
+        const char *payload = map + pos + sizeof(rec);
+
+        if (pos + sizeof(rec) + rec.len > (size_t)st.st_size) {
+            printf("Truncated record at offset %zu, stopping\n", pos);
+            break;
+        }
+        pos += sizeof(rec) + rec.len;
+
+        ReplayClient *rc = &replay_clients[rec.client];
+        if (rec.type == CAP_PAYLOAD && rec.slot != rec.client) {
+            stats.recorded_outside++;
+        }
+
+        // the target server keeps its own slot clock, so a payload is held
+        // until its sender's slot comes round there and then sent the same
+        // time into the slot as recorded. the first payload of each recorded
+        // slot waits for a fresh turn, speed only scales the time between slots
+        long long target = (speed > 0) ? start + shift + (long long)(rec.time_us / speed) : 0;
+        if (rec.type == CAP_PAYLOAD) {
+            if (speed > 0 && rc->rec_slot_us >= 0 && rc->burst_slot_us != rc->rec_slot_us) {
+                rc->burst_slot_us = rc->rec_slot_us;
+                rc->burst_aligned = wait_for_turn(rc, rec.time_us - rc->rec_slot_us) == 0;
+            }
+            if (speed > 0 && rc->burst_aligned) {
+                target = rc->turn_start_us + (long long)(rec.time_us - rc->rec_slot_us);
+                shift = target - start - (long long)(rec.time_us / speed);
+            } else {
+                stats.unaligned++;
+            }
+        }
+
+        // hold each event until its target time
+        if (speed > 0) {
+            wait_until(target);
+            if (get_monotonic_us() - target > 1000) {
+                stats.late_events++;
+            }
+        } else {
+            drain_replies();
+        }
+        last_event_us = rec.time_us;
+
+        switch (rec.type) {
+            case CAP_ACCEPT:
+                if (rc->socket >= 0) {
+                    close(rc->socket);
+                }
+                rc->socket = connect_to_server(&serv_addr);
+                rc->line_pos = 0;
+                rc->my_turn = 0;
+                rc->turns = 0;
+                rc->used_turn = 0;
+                rc->burst_slot_us = -1;
+                rc->burst_aligned = 0;
+                if (rc->socket < 0) {
+                    printf("Connect for client %d failed\n", rec.client + 1);
+                }
+                stats.accepts++;
+                break;
+            case CAP_DISCONNECT:
+                if (rc->socket >= 0) {
+                    close(rc->socket);
+                    rc->socket = -1;
+                }
+                stats.disconnects++;
+                break;
+            case CAP_PAYLOAD:
+                if (rc->socket >= 0 && send(rc->socket, payload, rec.len, 0) < 0) {
+                    printf("Send for client %d failed\n", rec.client + 1);
+                }
+                stats.payloads++;
+                stats.payload_bytes += rec.len;
+                break;
+            case CAP_SLOT:
+                // client i owns slot i, remember when its slot started for its payloads
+                replay_clients[rec.slot].rec_slot_us = rec.time_us;
+                stats.slots++;
+                break;
+            default:
+                printf("Unknown record type %d at offset %zu\n", rec.type, pos);
+                break;
+        }
+    }
+
+    // give the server a moment to answer the last payloads
+    wait_until(get_monotonic_us() + 200000);
+
+    long long elapsed = get_monotonic_us() - start;
+    printf("\n=== Replay Summary ===\n");
+    printf("Recorded duration: %.3f s\n", last_event_us / 1000000.0);
+    printf("Replay duration: %.3f s\n", elapsed / 1000000.0);
+    printf("Accepts: %lu | Disconnects: %lu | Slot changes: %lu\n",
+           stats.accepts, stats.disconnects, stats.slots);
+    printf("Payloads: %lu (%llu bytes, %.1f KB/s)\n",
+           stats.payloads, stats.payload_bytes,
+           elapsed > 0 ? (stats.payload_bytes / 1024.0) / (elapsed / 1000000.0) : 0.0);
+    printf("Replies: %llu bytes | MESSAGE: %lu | COLLISION: %lu\n",
+           stats.reply_bytes, stats.replies_message, stats.replies_collision);
+    printf("Recorded payloads outside the sender's slot: %lu | Sent without slot alignment: %lu\n",
+           stats.recorded_outside, stats.unaligned);
+    printf("Late events (>1 ms): %lu\n", stats.late_events);
+
+    for (int i = 0; i < MAX_REPLAY_CLIENTS; i++) {
+        if (replay_clients[i].socket >= 0) {
+            close(replay_clients[i].socket);
+        }
+    }
+    munmap((void *)map, st.st_size);
+    return 0;
+}
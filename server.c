@@ -1,3 +1,4 @@
+#define _GNU_SOURCE
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -6,12 +7,59 @@
 #include <sys/socket.h>
 #include <sys/select.h>
 #include <sys/time.h>
+#include <time.h>
+#include <math.h>
 #include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdatomic.h>
+#include <sys/eventfd.h>
+#include <sys/ioctl.h>
+#include <linux/sockios.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/un.h>
+#include <sys/mman.h>
+#include <signal.h>
+#include "capture.h"
+#include "config.h"
+#include "shm_ring.h"
 
-#define PORT 8080
-#define MAX_CLIENTS 10
+#define PORT 8080  // default, -p or port= in the config file
+#define MAX_CLIENTS 10  // client table size, max_clients can only lower it
 #define BUFFER_SIZE 1024
-#define SLOT_DURATION_MS 100  // 100 milliseconds per time slot
+#define SLOT_DURATION_MS 100  // default 100 milliseconds per time slot
+#define MIN_SLOT_MS 10  // range accepted for slot_duration_ms
+#define MAX_SLOT_MS 10000
+#define MIN_MESSAGE 16  // smallest max_message accepted
+#define LISTEN_BACKLOG 128  // default accept queue, the kernel caps it at net.core.somaxconn
+#define MAX_BACKLOG 4096
+#define RT_RING_SIZE 64  // slot events buffered between timing and I/O threads
+#define RT_HIST_US 20000  // lateness histogram range, later values go in the last bucket
+#define RT_REPORT_MS 10000  // how often real-time timing stats are printed
+#define CREDIT_BACKLOG_BYTES 32768  // unsent bytes allowed toward the slowest recipient
+#define CREDIT_MAX 64  // most messages granted for one slot
+#define MESSAGE_OVERHEAD 32  // MESSAGE|from=|slot=|text= header added by the server
+#define RESUME_GRACE_MS 5000  // how long a dropped client's slot stays reserved
+#define TOKEN_LEN 16  // hex characters in a resume token
+#define MAX_PENDING 4  // connections waiting to resume while the server is full
+#define PENDING_TIMEOUT_MS 1000  // how long such a connection has to send RESUME
+#define USER_TIMEOUT_MS 500  // drop a link whose sent data goes unacked this long
+#define MAX_GUARD_MS (config.slot_duration_ms / 5)  // widest acceptance window extension
+#define LAG_GAIN 8  // moving average weight 1/LAG_GAIN for the lag estimate
+#define LAG_MIN_SAMPLES 4  // samples needed before the lag estimate is reported
+#define SYNC_TAG "SYNC|"  // prefix on a line the client sent from a backlog at its slot start
+#define SYNC_TAG_LEN 5
+
+// settings that can change while the server runs
+typedef struct {
+    int port;
+    int max_clients;       // at most MAX_CLIENTS
+    int max_message;       // longest line relayed, at most BUFFER_SIZE - 1
+    int slot_duration_ms;
+    int listen_backlog;    // connections the kernel queues before we accept them
+} ServerConfig;
 
 // structure to stroe client data
 typedef struct {
@@ -19,19 +67,91 @@ typedef struct {
     struct sockaddr_in address;
     int active;
     int slot_number;  // TDMA slot assignment
+    char rx_buf[BUFFER_SIZE];  // partial line received so far
+    int rx_len;
+    int credits;       // messages granted for the current slot, -1 if not granted
+    int credits_used;  // messages received in the current slot
+    int avg_msg_len;   // moving average of this client's message length
+    int suspended;     // connection dropped, slot kept for RESUME_GRACE_MS
+    long long suspended_at;
+    char token[TOKEN_LEN + 1];  // resume token sent in WELCOME
+    ShmRegion *shm;    // shared-memory rings for local clients, NULL for TCP
+    int doorbell_in;   // eventfd the client rings after writing to_server
+    int doorbell_out;  // eventfd we ring after writing to_client
+    double lag_mean;   // estimated arrival delay of the first message in a slot, ms
+    double lag_var;    // variance of that delay
+    int lag_samples;
+    long long lag_slot_start;  // slot occurrence the last sample came from
+    int guard_early;   // ms accepted before the slot starts
+    int guard_late;    // ms accepted after the slot ends
+    int sent_lag;      // lag and guard last reported in TDMA_INFO
+    int sent_guard;
+    int awaiting_layout;  // admitted, gets its timing once the frame is rebuilt
 } Client;
 
+// connection accepted while all slots were taken, it may only resume
+typedef struct {
+    int socket;
+    long long accepted_at;
+    char rx_buf[BUFFER_SIZE];
+    int rx_len;
+} PendingConnection;
+
 // structure to see how many clients we have to split
 typedef struct {
     int frame_number;
     int current_slot;
     long long frame_start_time;
+    long long slot_start_time;  // when the current slot began
     int active_slots;  // Number of slots currently in use
 } TDMAScheduler;
 
+// slot boundary handed from the timing thread to the I/O loop
+typedef struct {
+    int slot;
+    int frame;
+    long long boundary_us;  // scheduled boundary (monotonic)
+    long long wake_us;      // when the timing thread actually woke up
+    int slot_ms;            // duration the timing thread is running this slot at
+} SlotEvent;
+
+// single producer / single consumer ring, both sides are wait-free
+typedef struct {
+    SlotEvent events[RT_RING_SIZE];
+    atomic_uint head;  // next event to read, written by the I/O loop
+    atomic_uint tail;  // next event to write, written by the timing thread
+    atomic_ulong dropped;  // events lost because the I/O loop fell behind
+} SlotEventRing;
+
+// lateness histograms kept by the I/O loop, in microseconds
+typedef struct {
+    unsigned long timer_hist[RT_HIST_US + 1];     // boundary to timing thread wake-up
+    unsigned long dispatch_hist[RT_HIST_US + 1];  // boundary to broadcast in the I/O loop
+    long long timer_max;
+    long long dispatch_max;
+    unsigned long boundaries;
+    unsigned long skipped;  // boundaries superseded by a newer one before the I/O loop got to them
+} RTStats;
+
 Client clients[MAX_CLIENTS];
+PendingConnection pending[MAX_PENDING];
 int client_count = 0;
 TDMAScheduler tdma;
+FILE *capture_file = NULL;  // traffic capture, NULL when not recording
+long long capture_start_us = 0;
+int rt_mode = 0;  // slot timing runs on its own thread
+int rt_cpu = -1;
+int rt_eventfd = -1;  // doorbell the timing thread rings for the I/O loop
+atomic_int rt_active_slots = 1;  // copy of tdma.active_slots for the timing thread
+SlotEventRing rt_ring;
+RTStats rt_stats;
+atomic_int rt_slot_duration_ms = SLOT_DURATION_MS;  // latest loaded slot duration, taken up at each frame start
+ServerConfig config = {PORT, MAX_CLIENTS, BUFFER_SIZE - 1, SLOT_DURATION_MS, LISTEN_BACKLOG};
+int admitted_count = 0;  // clients added since the frame was last rebuilt
+ServerConfig pending_config;  // reloaded settings waiting for the next frame boundary
+int config_waiting = 0;
+const char *config_path = NULL;
+volatile sig_atomic_t reload_requested = 0;
 
 // Get current time in milliseconds
 long long get_time_ms() {
@@ -40,10 +160,114 @@ long long get_time_ms() {
     return (long long)(tv.tv_sec) * 1000 + (tv.tv_usec) / 1000;
 }
 
+// Get monotonic time in microseconds
+long long get_monotonic_us() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long long)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+// start recording traffic to an append-only capture file
+int open_capture(const char *path) {
+    capture_file = fopen(path, "wb");
+    if (capture_file == NULL) {
+        return -1;
+    }
+    setvbuf(capture_file, NULL, _IOFBF, 64 * 1024);
+    fwrite(CAPTURE_MAGIC, 1, CAPTURE_MAGIC_LEN, capture_file);
+    capture_start_us = get_monotonic_us();
+    return 0;
+}
+
+// append one event to the capture file if recording
+void capture_event(int type, int client_index, const void *data, int len) {
+    if (capture_file == NULL) {
+        return;
+    }
+    
+    CaptureRecord rec;
+    rec.time_us = get_monotonic_us() - capture_start_us;
+    rec.type = type;
+    rec.client = client_index;
+    rec.slot = tdma.current_slot;
+    rec.active_slots = tdma.active_slots;
+    rec.len = len;
+    
+    fwrite(&rec, sizeof(rec), 1, capture_file);
+    if (len > 0) {
+        fwrite(data, 1, len, capture_file);
+    }
+    
+    // slot changes come every slot duration, flush there so Ctrl+C loses little
+    if (type == CAP_SLOT) {
+        fflush(capture_file);
+    }
+}
+
+// parse one server setting into a ServerConfig, used for -c files and reloads
+int apply_server_setting(void *target, const char *key, const char *value) {
+    ServerConfig *cfg = target;
+    char *end;
+    long number = strtol(value, &end, 10);
+    
+    if (*value == '\0' || *end != '\0') {
+        return -1;
+    }
+    
+    if (strcmp(key, "port") == 0 && number > 0 && number <= 65535) {
+        cfg->port = number;
+    } else if (strcmp(key, "max_clients") == 0 && number >= 1 && number <= MAX_CLIENTS) {
+        cfg->max_clients = number;
+    } else if (strcmp(key, "max_message") == 0 && number >= MIN_MESSAGE && number <= BUFFER_SIZE - 1) {
+        cfg->max_message = number;
+    } else if (strcmp(key, "slot_duration_ms") == 0 && number >= MIN_SLOT_MS && number <= MAX_SLOT_MS) {
+        cfg->slot_duration_ms = number;
+    } else if (strcmp(key, "listen_backlog") == 0 && number >= 1 && number <= MAX_BACKLOG) {
+        cfg->listen_backlog = number;
+    } else {
+        return -1;
+    }
+    return 0;
+}
+
+// SIGHUP asks the main loop to re-read the config file
+void handle_sighup(int sig) {
+    (void)sig;
+    reload_requested = 1;
+}
+
+// re-read the config file on top of the current settings, a file with any bad
+// line is ignored as a whole so a typo cannot half-apply
+void reload_config() {
+    reload_requested = 0;
+    if (config_path == NULL) {
+        printf("[CONFIG] Reload requested but no config file was given with -c\n");
+        return;
+    }
+    
+    ServerConfig loaded = config_waiting ? pending_config : config;
+    int errors = config_load(config_path, apply_server_setting, &loaded);
+    if (errors < 0) {
+        printf("[CONFIG] Cannot read %s, keeping current settings\n", config_path);
+        return;
+    }
+    if (errors > 0) {
+        printf("[CONFIG] %d bad line(s) in %s, keeping current settings\n", errors, config_path);
+        return;
+    }
+    
+    pending_config = loaded;
+    config_waiting = 1;
+    // the timing thread switches over by itself when it starts the next frame
+    atomic_store(&rt_slot_duration_ms, loaded.slot_duration_ms);
+    printf("[CONFIG] Reloaded %s, applying at the next frame boundary\n", config_path);
+}
+
 void initialize_tdma() {
     tdma.frame_number = 0;
     tdma.current_slot = 0;
     tdma.frame_start_time = get_time_ms();
+    tdma.slot_start_time = tdma.frame_start_time;
     tdma.active_slots = 1;  // Start with at least 1 slot to avoid division by zero
 }
 
@@ -53,28 +277,32 @@ void update_tdma_slot() {
     long long elapsed = current_time - tdma.frame_start_time;
     
     // Calculate frame duration based on number of active slots
-    int frame_duration = tdma.active_slots * SLOT_DURATION_MS;
+    int frame_duration = tdma.active_slots * config.slot_duration_ms;
     
     // Calculate current slot based on elapsed time
-    int new_slot = (elapsed / SLOT_DURATION_MS) % tdma.active_slots;
+    int new_slot = (elapsed / config.slot_duration_ms) % tdma.active_slots;
     
     // Check if we've moved to a new frame
     if (elapsed >= frame_duration) {
         tdma.frame_number++;
         tdma.frame_start_time = current_time;
+        tdma.slot_start_time = current_time;
         tdma.current_slot = 0;
         // Removed repetitive frame start message
     } else if (new_slot != tdma.current_slot) {
         tdma.current_slot = new_slot;
+        tdma.slot_start_time = tdma.frame_start_time + (long long)new_slot * config.slot_duration_ms;
         // Removed repetitive slot active message
     }
 }
 
 // return client index whose slot matches the active slot
 int get_current_active_client() {
-    // Find which client has the current slot
+    // Find which client has the current slot, clients admitted since the last
+    // frame boundary are not in the frame yet and would only collide
     for (int i = 0; i < MAX_CLIENTS; i++) {
-        if (clients[i].active && clients[i].slot_number == tdma.current_slot) {
+        if (clients[i].active && !clients[i].awaiting_layout &&
+            clients[i].slot_number == tdma.current_slot) {
             return i;
         }
     }
@@ -83,14 +311,16 @@ int get_current_active_client() {
 
 // update teh number of tdma slot acording to clients
 void update_active_slots() {
-    // Count the number of active clients to determine active slots
+    // Count the number of active clients to determine active slots,
+    // suspended clients keep their slot in the frame until they expire
     int count = 0;
     for (int i = 0; i < MAX_CLIENTS; i++) {
-        if (clients[i].active) {
+        if (clients[i].active || clients[i].suspended) {
             count++;
         }
     }
     tdma.active_slots = (count > 0) ? count : 1;  // Minimum 1 slot
+    atomic_store(&rt_active_slots, tdma.active_slots);
     printf("[TDMA] Active slots updated: %d\n", tdma.active_slots);
 }
 
@@ -98,8 +328,8 @@ void update_active_slots() {
 long long get_time_until_next_slot() {
     long long current_time = get_time_ms();
     long long elapsed = current_time - tdma.frame_start_time;
-    long long slot_elapsed = elapsed % SLOT_DURATION_MS;
-    return SLOT_DURATION_MS - slot_elapsed;
+    long long slot_elapsed = elapsed % config.slot_duration_ms;
+    return config.slot_duration_ms - slot_elapsed;
 }
 
 // return time until clients slot becomes active
@@ -113,9 +343,9 @@ long long get_time_to_client_slot(int client_index) {
     if (slot == tdma.current_slot) {
         return get_time_until_next_slot();
     } else if (slot > tdma.current_slot) {
-        return (slot - tdma.current_slot) * SLOT_DURATION_MS;
+        return (slot - tdma.current_slot) * config.slot_duration_ms;
     } else {
-        return (tdma.active_slots - tdma.current_slot + slot) * SLOT_DURATION_MS;
+        return (tdma.active_slots - tdma.current_slot + slot) * config.slot_duration_ms;
     }
 }
 
@@ -124,19 +354,84 @@ void initialize_clients() {
         clients[i].socket = -1;
         clients[i].active = 0;
         clients[i].slot_number = -1;
+        clients[i].rx_len = 0;
+        clients[i].credits = -1;
+        clients[i].credits_used = 0;
+        clients[i].avg_msg_len = 64;
+        clients[i].suspended = 0;
+        clients[i].token[0] = '\0';
+        clients[i].shm = NULL;
+        clients[i].doorbell_in = -1;
+        clients[i].doorbell_out = -1;
+        clients[i].awaiting_layout = 0;
+    }
+    for (int i = 0; i < MAX_PENDING; i++) {
+        pending[i].socket = -1;
     }
 }
 
+// make a random resume token
+void generate_token(char *token) {
+    unsigned char bytes[TOKEN_LEN / 2];
+    FILE *fp = fopen("/dev/urandom", "rb");
+    
+    if (fp == NULL || fread(bytes, 1, sizeof(bytes), fp) != sizeof(bytes)) {
+        for (int i = 0; i < (int)sizeof(bytes); i++) {
+            bytes[i] = rand() & 0xff;
+        }
+    }
+    if (fp != NULL) {
+        fclose(fp);
+    }
+    
+    for (int i = 0; i < (int)sizeof(bytes); i++) {
+        snprintf(token + 2 * i, 3, "%02x", bytes[i]);
+    }
+}
+
+// detect dead Wi-Fi links within a few seconds instead of TCP's default hours
+void set_keepalive(int sd) {
+    int on = 1, idle = 1, interval = 1, count = 3;
+    setsockopt(sd, SOL_SOCKET, SO_KEEPALIVE, &on, sizeof(on));
+    setsockopt(sd, IPPROTO_TCP, TCP_KEEPIDLE, &idle, sizeof(idle));
+    setsockopt(sd, IPPROTO_TCP, TCP_KEEPINTVL, &interval, sizeof(interval));
+    setsockopt(sd, IPPROTO_TCP, TCP_KEEPCNT, &count, sizeof(count));
+    
+    // keepalive stays quiet while data is unacked, this bounds that case
+    int user_timeout = USER_TIMEOUT_MS;
+    setsockopt(sd, IPPROTO_TCP, TCP_USER_TIMEOUT, &user_timeout, sizeof(user_timeout));
+}
+
+// forget a client's timing history, guards start at zero like a hard slot check
+void reset_drift(int index) {
+    clients[index].lag_mean = 0;
+    clients[index].lag_var = 0;
+    clients[index].lag_samples = 0;
+    clients[index].lag_slot_start = -1;
+    clients[index].guard_early = 0;
+    clients[index].guard_late = 0;
+    clients[index].sent_lag = -1;
+    clients[index].sent_guard = -1;
+}
+
 // add a new client and assign time slot
 int add_client(int socket, struct sockaddr_in address) {
-    for (int i = 0; i < MAX_CLIENTS; i++) {
-        if (!clients[i].active) {
+    for (int i = 0; i < config.max_clients; i++) {
+        if (!clients[i].active && !clients[i].suspended) {
             clients[i].socket = socket;
             clients[i].address = address;
             clients[i].active = 1;
             clients[i].slot_number = i;  // Assign slot based on index
+            clients[i].rx_len = 0;
+            clients[i].credits = -1;
+            clients[i].credits_used = 0;
+            clients[i].avg_msg_len = 64;
+            generate_token(clients[i].token);
+            reset_drift(i);
             client_count++;
-            update_active_slots();  // Update TDMA frame based on new client count
+            // the frame is resized for all new clients at once, see apply_admissions()
+            clients[i].awaiting_layout = 1;
+            admitted_count++;
             return i;
         }
     }
@@ -150,25 +445,166 @@ void remove_client(int index) {
         clients[index].socket = -1;
         clients[index].active = 0;
         clients[index].slot_number = -1;
+        clients[index].rx_len = 0;
+        if (clients[index].awaiting_layout) {
+            clients[index].awaiting_layout = 0;
+            admitted_count--;
+        }
         client_count--;
         update_active_slots();  // Update TDMA frame based on new client count
     }
 }
 
+// keep a dropped client's slot reserved so it can resume
+void suspend_client(int index) {
+    if (clients[index].active) {
+        close(clients[index].socket);
+        clients[index].socket = -1;
+        clients[index].active = 0;
+        clients[index].rx_len = 0;
+        clients[index].suspended = 1;
+        clients[index].suspended_at = get_time_ms();
+        client_count--;
+        printf("Client %d suspended, Slot %d reserved for %d ms\n",
+               index + 1, clients[index].slot_number, RESUME_GRACE_MS);
+    }
+}
+
+// free the slots of suspended clients that did not come back in time
+void expire_suspended_clients() {
+    long long now = get_time_ms();
+    
+    for (int i = 0; i < MAX_CLIENTS; i++) {
+        if (clients[i].suspended && now - clients[i].suspended_at >= RESUME_GRACE_MS) {
+            printf("Client %d did not resume, Slot %d released\n", i + 1, clients[i].slot_number);
+            clients[i].suspended = 0;
+            clients[i].slot_number = -1;
+            clients[i].token[0] = '\0';
+            update_active_slots();
+        }
+    }
+}
+
+// send to a client over TCP or its shared-memory ring
+int client_send(int client_index, const char *data, int len) {
+    Client *c = &clients[client_index];
+    
+    if (c->shm == NULL) {
+        return send(c->socket, data, len, 0);
+    }
+    
+    // a full ring means the local client stopped reading, drop like a failed send
+    if (!shm_ring_write(&c->shm->to_client, data, len)) {
+        return -1;
+    }
+    uint64_t one = 1;
+    if (write(c->doorbell_out, &one, sizeof(one)) < 0) {
+        // counter saturated, the client still sees the data in the ring
+    }
+    return len;
+}
+
+// bytes sent to a client that it has not taken yet
+int client_backlog(int client_index) {
+    int pending = 0;
+    
+    if (clients[client_index].shm != NULL) {
+        return shm_ring_used(&clients[client_index].shm->to_client);
+    }
+    if (ioctl(clients[client_index].socket, SIOCOUTQ, &pending) < 0) {
+        return 0;
+    }
+    return pending;
+}
+
+// tear down a local client's rings and doorbells and free its slot
+void remove_local_client(int index) {
+    munmap(clients[index].shm, sizeof(ShmRegion));
+    close(clients[index].doorbell_in);
+    close(clients[index].doorbell_out);
+    clients[index].shm = NULL;
+    clients[index].doorbell_in = -1;
+    clients[index].doorbell_out = -1;
+    clients[index].token[0] = '\0';
+    remove_client(index);
+}
+
+// lag estimate in whole ms as sent in TDMA_INFO, -1 until there are enough samples
+int reported_lag(int client_index) {
+    if (clients[client_index].lag_samples < LAG_MIN_SAMPLES) {
+        return -1;
+    }
+    return (int)(clients[client_index].lag_mean + 0.5);
+}
+
 // send timing info to a specific client
 void send_tdma_info_to_client(int client_index) {
     char tdma_msg[BUFFER_SIZE];
     long long time_to_slot = get_time_to_client_slot(client_index);
     
+    // lag=-1 tells the client there is no estimate yet
+    clients[client_index].sent_lag = reported_lag(client_index);
+    clients[client_index].sent_guard = clients[client_index].guard_late;
+    
     snprintf(tdma_msg, sizeof(tdma_msg),
-             "TDMA_INFO|slot=%d|slot_duration=%d|frame=%d|time_to_slot=%lld|active_slots=%d\n",
+             "TDMA_INFO|slot=%d|slot_duration=%d|frame=%d|time_to_slot=%lld|active_slots=%d|lag=%d|guard=%d\n",
              clients[client_index].slot_number,
-             SLOT_DURATION_MS,
+             config.slot_duration_ms,
              tdma.frame_number,
              time_to_slot,
-             tdma.active_slots);
+             tdma.active_slots,
+             clients[client_index].sent_lag,
+             clients[client_index].sent_guard);
+    
+    client_send(client_index, tdma_msg, strlen(tdma_msg));
+}
+
+// tell a client the limits currently in force
+void send_config_to_client(int client_index) {
+    char config_msg[200];
+    snprintf(config_msg, sizeof(config_msg),
+             "CONFIG|slot_duration=%d|max_clients=%d|max_message=%d\n",
+             config.slot_duration_ms, config.max_clients, config.max_message);
+    client_send(client_index, config_msg, strlen(config_msg));
+}
+
+// send the WELCOME line and limits to a newly added client, its timing info
+// follows when the frame is rebuilt
+void send_welcome(int client_index) {
+    char welcome[200];
+    snprintf(welcome, sizeof(welcome), 
+            "WELCOME|client_id=%d|slot=%d|slot_duration=%d|token=%s\n",
+            client_index + 1, 
+            clients[client_index].slot_number,
+            config.slot_duration_ms,
+            clients[client_index].token);
+    client_send(client_index, welcome, strlen(welcome));
     
-    send(clients[client_index].socket, tdma_msg, strlen(tdma_msg), 0);
+    // Send initial limits
+    send_config_to_client(client_index);
+}
+
+// work out how many messages a client may send in its slot, from how much
+// fan-out is still sitting unsent in the other clients' socket buffers
+int compute_credits(int client_index) {
+    int max_backlog = 0;
+    
+    for (int i = 0; i < MAX_CLIENTS; i++) {
+        if (clients[i].active && i != client_index) {
+            int pending = client_backlog(i);
+            if (pending > max_backlog) {
+                max_backlog = pending;
+            }
+        }
+    }
+    
+    int budget = CREDIT_BACKLOG_BYTES - max_backlog;
+    if (budget <= 0) {
+        return 0;
+    }
+    
+    int credits = budget / (clients[client_index].avg_msg_len + MESSAGE_OVERHEAD);
+    return (credits < CREDIT_MAX) ? credits : CREDIT_MAX;
 }
 
 // inform client when their turn
@@ -176,12 +612,30 @@ void broadcast_slot_change() {
     char slot_msg[BUFFER_SIZE];
     int active_client = get_current_active_client();
     
+    for (int i = 0; i < MAX_CLIENTS; i++) {
+        // report clients that sent more than they were granted in their last slot
+        if (clients[i].active && clients[i].credits >= 0 &&
+            clients[i].credits_used > clients[i].credits) {
+            printf("[FLOW] Client %d sent %d messages with %d credits\n",
+                   i + 1, clients[i].credits_used, clients[i].credits);
+        }
+        clients[i].credits = -1;
+        clients[i].credits_used = 0;
+    }
+    
     for (int i = 0; i < MAX_CLIENTS; i++) {
         if (clients[i].active) {
             if (i == active_client) {
+                clients[i].credits = compute_credits(i);
                 snprintf(slot_msg, sizeof(slot_msg), 
-                        "SLOT_ACTIVE|your_turn=1|slot=%d|duration=%d|active_slots=%d\n",
-                        tdma.current_slot, SLOT_DURATION_MS, tdma.active_slots);
+                        "SLOT_ACTIVE|your_turn=1|slot=%d|duration=%d|active_slots=%d|credits=%d\n",
+                        tdma.current_slot, config.slot_duration_ms, tdma.active_slots, clients[i].credits);
+                
+                // push a timing correction when the client's estimate moved
+                if (reported_lag(i) != clients[i].sent_lag ||
+                    clients[i].guard_late != clients[i].sent_guard) {
+                    send_tdma_info_to_client(i);
+                }
             } else {
                 long long time_to_slot = get_time_to_client_slot(i);
                 
@@ -189,85 +643,913 @@ void broadcast_slot_change() {
                         "SLOT_ACTIVE|your_turn=0|current_slot=%d|your_slot=%d|wait_time=%lld|active_slots=%d\n",
                         tdma.current_slot, clients[i].slot_number, time_to_slot, tdma.active_slots);
             }
-            send(clients[i].socket, slot_msg, strlen(slot_msg), 0);
+            client_send(i, slot_msg, strlen(slot_msg));
+        }
+    }
+}
+
+// switch to reloaded settings, called at a frame boundary so no slot is cut
+// short, connected clients keep their slots and are sent the new parameters
+// slot_ms is the duration the new frame actually runs at, in real-time mode
+// the timing thread may not have picked up a reload that arrived late in the
+// old frame, then the rest waits for the frame that does carry it
+void apply_pending_config(int slot_ms) {
+    if (config_waiting && pending_config.slot_duration_ms == slot_ms) {
+        config_waiting = 0;
+        config = pending_config;
+    } else if (slot_ms != config.slot_duration_ms) {
+        // a newer reload replaced the one the timing thread switched to
+        config.slot_duration_ms = slot_ms;
+    } else {
+        return;
+    }
+    
+    printf("[CONFIG] Applied at frame %d: slot_duration=%d ms, max_clients=%d, max_message=%d, port=%d, listen_backlog=%d\n",
+           tdma.frame_number, config.slot_duration_ms, config.max_clients,
+           config.max_message, config.port, config.listen_backlog);
+    
+    for (int i = 0; i < MAX_CLIENTS; i++) {
+        if (clients[i].active) {
+            // guards learned under a longer slot may now be too wide
+            if (clients[i].guard_early > MAX_GUARD_MS) {
+                clients[i].guard_early = MAX_GUARD_MS;
+            }
+            if (clients[i].guard_late > MAX_GUARD_MS) {
+                clients[i].guard_late = MAX_GUARD_MS;
+            }
+            send_config_to_client(i);
+            send_tdma_info_to_client(i);
+        }
+    }
+}
+
+// fold every client admitted since the last frame into one re-layout, so a
+// burst of connections after an AP reboot rebuilds the frame once instead
+// of once per client and never in the middle of someone else's slot
+void apply_admissions() {
+    if (admitted_count == 0) {
+        return;
+    }
+    
+    update_active_slots();
+    printf("[TDMA] Frame %d: admitted %d client(s), %d active slots\n",
+           tdma.frame_number, admitted_count, tdma.active_slots);
+    admitted_count = 0;
+    
+    for (int i = 0; i < MAX_CLIENTS; i++) {
+        // a client that dropped meanwhile keeps its reserved slot in the new frame
+        if (clients[i].awaiting_layout) {
+            clients[i].awaiting_layout = 0;
+            if (clients[i].active) {
+                send_tdma_info_to_client(i);
+            }
+        }
+    }
+}
+
+// timing thread: sleeps to each absolute slot boundary and hands it to the I/O loop
+void *slot_timer_thread(void *arg) {
+    int slot = 0;
+    int frame = 0;
+    int slot_ms = atomic_load(&rt_slot_duration_ms);
+    long long boundary_us = get_monotonic_us();
+    
+    while (1) {
+        boundary_us += slot_ms * 1000;
+        struct timespec ts;
+        ts.tv_sec = boundary_us / 1000000;
+        ts.tv_nsec = (boundary_us % 1000000) * 1000;
+        while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL) == EINTR) {
+        }
+        long long wake_us = get_monotonic_us();
+        
+        // same frame rules as update_tdma_slot(), frame size can change under us
+        slot++;
+        if (slot >= atomic_load(&rt_active_slots)) {
+            slot = 0;
+            frame++;
+            // a reloaded slot duration starts with a new frame
+            slot_ms = atomic_load(&rt_slot_duration_ms);
+        }
+        
+        unsigned int tail = atomic_load_explicit(&rt_ring.tail, memory_order_relaxed);
+        unsigned int head = atomic_load_explicit(&rt_ring.head, memory_order_acquire);
+        if (tail - head == RT_RING_SIZE) {
+            atomic_fetch_add(&rt_ring.dropped, 1);
+        } else {
+            SlotEvent *ev = &rt_ring.events[tail % RT_RING_SIZE];
+            ev->slot = slot;
+            ev->frame = frame;
+            ev->boundary_us = boundary_us;
+            ev->wake_us = wake_us;
+            ev->slot_ms = slot_ms;
+            atomic_store_explicit(&rt_ring.tail, tail + 1, memory_order_release);
+        }
+        
+        uint64_t one = 1;
+        if (write(rt_eventfd, &one, sizeof(one)) < 0) {
+            // counter saturated, the I/O loop will still see the ring
         }
     }
+    return NULL;
+}
+
+// start the timing thread, pinned and SCHED_FIFO when allowed
+int start_slot_timer() {
+    pthread_t timer_thread;
+    
+    rt_eventfd = eventfd(0, EFD_NONBLOCK);
+    if (rt_eventfd < 0) {
+        perror("eventfd failed");
+        return -1;
+    }
+    atomic_store(&rt_active_slots, tdma.active_slots);
+    
+    if (pthread_create(&timer_thread, NULL, slot_timer_thread, NULL) != 0) {
+        printf("Failed to create timing thread\n");
+        return -1;
+    }
+    
+    if (rt_cpu >= 0) {
+        cpu_set_t cpus;
+        CPU_ZERO(&cpus);
+        CPU_SET(rt_cpu, &cpus);
+        if (pthread_setaffinity_np(timer_thread, sizeof(cpus), &cpus) != 0) {
+            printf("[RT] Could not pin timing thread to CPU %d\n", rt_cpu);
+        } else {
+            printf("[RT] Timing thread pinned to CPU %d\n", rt_cpu);
+        }
+    }
+    
+    struct sched_param param;
+    param.sched_priority = sched_get_priority_max(SCHED_FIFO);
+    if (pthread_setschedparam(timer_thread, SCHED_FIFO, &param) != 0) {
+        printf("[RT] SCHED_FIFO not permitted, timing thread uses normal priority\n");
+    } else {
+        printf("[RT] Timing thread running SCHED_FIFO priority %d\n", param.sched_priority);
+    }
+    
+    pthread_detach(timer_thread);
+    return 0;
+}
+
+void record_lateness(unsigned long *hist, long long *max, long long late_us) {
+    if (late_us < 0) {
+        late_us = 0;
+    }
+    if (late_us > *max) {
+        *max = late_us;
+    }
+    hist[late_us < RT_HIST_US ? late_us : RT_HIST_US]++;
+}
+
+// smallest lateness that covers the given fraction of boundaries
+long long hist_percentile(const unsigned long *hist, double fraction) {
+    unsigned long target = (unsigned long)(rt_stats.boundaries * fraction);
+    unsigned long seen = 0;
+    for (int us = 0; us <= RT_HIST_US; us++) {
+        seen += hist[us];
+        if (seen > target) {
+            return us;
+        }
+    }
+    return RT_HIST_US;
+}
+
+void print_rt_stats() {
+    if (rt_stats.boundaries == 0) {
+        return;
+    }
+    printf("[RT] Boundaries: %lu | Timer late us p50=%lld p99=%lld p99.9=%lld max=%lld"
+           " | Dispatch late us p50=%lld p99=%lld p99.9=%lld max=%lld | Dropped: %lu | Skipped: %lu\n",
+           rt_stats.boundaries,
+           hist_percentile(rt_stats.timer_hist, 0.5),
+           hist_percentile(rt_stats.timer_hist, 0.99),
+           hist_percentile(rt_stats.timer_hist, 0.999),
+           rt_stats.timer_max,
+           hist_percentile(rt_stats.dispatch_hist, 0.5),
+           hist_percentile(rt_stats.dispatch_hist, 0.99),
+           hist_percentile(rt_stats.dispatch_hist, 0.999),
+           rt_stats.dispatch_max,
+           atomic_load(&rt_ring.dropped),
+           rt_stats.skipped);
+}
+
+// apply the boundaries the timing thread queued and notify clients
+// after a stall only the newest one is broadcast, a your_turn=1 for a slot
+// that already ended would just make its owner transmit late
+void drain_slot_events() {
+    SlotEvent events[RT_RING_SIZE];
+    int n = 0;
+    uint64_t count;
+    if (read(rt_eventfd, &count, sizeof(count)) < 0) {
+        // nothing pending, the ring is checked anyway
+    }
+    
+    while (n < RT_RING_SIZE) {
+        unsigned int head = atomic_load_explicit(&rt_ring.head, memory_order_relaxed);
+        unsigned int tail = atomic_load_explicit(&rt_ring.tail, memory_order_acquire);
+        if (head == tail) {
+            break;
+        }
+        events[n++] = rt_ring.events[head % RT_RING_SIZE];
+        atomic_store_explicit(&rt_ring.head, head + 1, memory_order_release);
+    }
+    if (n == 0) {
+        return;
+    }
+    
+    // frame starts still take reloads and admissions, even when skipped
+    for (int e = 0; e < n; e++) {
+        if (events[e].slot == 0) {
+            tdma.frame_number = events[e].frame;
+            apply_pending_config(events[e].slot_ms);
+            apply_admissions();
+        }
+    }
+    rt_stats.skipped += n - 1;
+    
+    SlotEvent *ev = &events[n - 1];
+    tdma.frame_number = ev->frame;
+    tdma.current_slot = ev->slot < tdma.active_slots ? ev->slot : 0;
+    // measured from the scheduled boundary so a late dispatch does not stretch the slot
+    tdma.slot_start_time = get_time_ms() - (get_monotonic_us() - ev->boundary_us) / 1000;
+    tdma.frame_start_time = tdma.slot_start_time - (long long)tdma.current_slot * config.slot_duration_ms;
+    
+    capture_event(CAP_SLOT, 0, NULL, 0);
+    broadcast_slot_change();
+    
+    long long now_us = get_monotonic_us();
+    for (int e = 0; e < n; e++) {
+        rt_stats.boundaries++;
+        record_lateness(rt_stats.timer_hist, &rt_stats.timer_max, events[e].wake_us - events[e].boundary_us);
+        record_lateness(rt_stats.dispatch_hist, &rt_stats.dispatch_max, now_us - events[e].boundary_us);
+    }
+}
+
+// build the MESSAGE line relayed to the other clients, returns its length
+int format_message(char *out, int size, const char *message, int sender_index) {
+    int len = snprintf(out, size, 
+                       "MESSAGE|from=%d|slot=%d|text=%s\n",
+                       sender_index + 1, clients[sender_index].slot_number, message);
+    return (len < size) ? len : size - 1;
 }
 
 // THIS IS A FUNCTION that sends message from one client to others
 void broadcast_message(const char *message, int sender_index) {
     char formatted_msg[BUFFER_SIZE + 50];
-    snprintf(formatted_msg, sizeof(formatted_msg), 
-             "MESSAGE|from=%d|slot=%d|text=%s\n",
-             sender_index + 1, clients[sender_index].slot_number, message);
+    int len = format_message(formatted_msg, sizeof(formatted_msg), message, sender_index);
     
-    printf("Broadcasting from Client %d (Slot %d): %s\n", 
-           sender_index + 1, clients[sender_index].slot_number, message);
+    // fragments carry hex payloads, only log their header
+    if (strncmp(message, "FRAG|", 5) == 0) {
+        const char *data = strstr(message, "|data=");
+        int header_len = data ? (int)(data - message) : (int)strlen(message);
+        printf("Broadcasting from Client %d (Slot %d): %.*s\n", 
+               sender_index + 1, clients[sender_index].slot_number, header_len, message);
+    } else {
+        printf("Broadcasting from Client %d (Slot %d): %s\n", 
+               sender_index + 1, clients[sender_index].slot_number, message);
+    }
     
     for (int i = 0; i < MAX_CLIENTS; i++) {
         if (clients[i].active && i != sender_index) {
-            if (send(clients[i].socket, formatted_msg, strlen(formatted_msg), 0) < 0) {
+            if (client_send(i, formatted_msg, len) < 0) {
                 printf("Failed to send to client %d\n", i + 1);
             }
         }
     }
 }
 
-int main() {
-    int server_socket, new_socket, max_sd, activity;
-    struct sockaddr_in server_addr, client_addr;
-    socklen_t addr_len = sizeof(client_addr);
-    fd_set read_fds;
-    struct timeval timeout;
-    char buffer[BUFFER_SIZE];
+// hand a connection the identity of the client holding the token, returns
+// that client's index or -1 if the token is unknown or expired
+// the holder may still look connected: a silently dropped Wi-Fi link is often
+// noticed by the client first, its old socket is then closed and replaced
+int resume_client(int sd, const char *line) {
+    char token[TOKEN_LEN + 1];
+    struct sockaddr_in address;
+    socklen_t addr_len = sizeof(address);
     
-    initialize_clients();
-    initialize_tdma();
+    if (sscanf(line, "RESUME|token=%16s", token) != 1) {
+        return -1;
+    }
     
-    // Create socket
-    if ((server_socket = socket(AF_INET, SOCK_STREAM, 0)) == 0) {
-        perror("Socket creation failed");
-        exit(EXIT_FAILURE);
+    for (int j = 0; j < MAX_CLIENTS; j++) {
+        int stale = clients[j].active && clients[j].shm == NULL && clients[j].socket != sd;
+        if ((clients[j].suspended || stale) && strcmp(clients[j].token, token) == 0) {
+            long long outage = 0;
+            if (stale) {
+                printf("Client %d reconnected before its old link timed out, closing it\n", j + 1);
+                capture_event(CAP_DISCONNECT, j, NULL, 0);
+                close(clients[j].socket);
+            } else {
+                outage = get_time_ms() - clients[j].suspended_at;
+                client_count++;
+            }
+            clients[j].socket = sd;
+            clients[j].active = 1;
+            clients[j].suspended = 0;
+            clients[j].rx_len = 0;
+            clients[j].credits = -1;
+            clients[j].credits_used = 0;
+            if (getpeername(sd, (struct sockaddr *)&address, &addr_len) == 0) {
+                clients[j].address = address;
+            }
+            capture_event(CAP_ACCEPT, j, &clients[j].address, sizeof(clients[j].address));
+            
+            char resumed[200];
+            snprintf(resumed, sizeof(resumed),
+                    "RESUMED|client_id=%d|slot=%d|slot_duration=%d|token=%s\n",
+                    j + 1, clients[j].slot_number, config.slot_duration_ms, clients[j].token);
+            send(sd, resumed, strlen(resumed), 0);
+            send_config_to_client(j);
+            send_tdma_info_to_client(j);
+            
+            printf("Client %d resumed Slot %d after %lld ms. Total clients: %d\n",
+                   j + 1, clients[j].slot_number, outage, client_count);
+            return j;
+        }
+    }
+    
+    send(sd, "RESUME_FAILED\n", 14, 0);
+    return -1;
+}
+
+// offset of now from the start of the nearest occurrence of a client's slot,
+// 0..slot duration inside it, negative before it, larger after it
+long long slot_offset_ms(int i, long long now) {
+    long long frame_ms = (long long)tdma.active_slots * config.slot_duration_ms;
+    long long start = tdma.slot_start_time +
+        (long long)(clients[i].slot_number - tdma.current_slot) * config.slot_duration_ms;
+    long long offset = ((now - start) % frame_ms + frame_ms) % frame_ms;
+    
+    // outside the slot, measure from whichever edge is closer, so with two
+    // slots a message just after ours ends is late rather than a slot early
+    if (offset >= config.slot_duration_ms && frame_ms - offset < offset - config.slot_duration_ms) {
+        offset -= frame_ms;
+    }
+    return offset;
+}
+
+// track how late a client's backlogged first message in each slot arrives and size
+// its acceptance window from that, so steady Wi-Fi latency stops causing edge collisions
+void update_drift(int i, long long offset, long long slot_start) {
+    Client *c = &clients[i];
+    
+    // one sample per slot occurrence, the first arrival shows the lag best
+    if (slot_start == c->lag_slot_start || offset < -config.slot_duration_ms || offset >= 2 * config.slot_duration_ms) {
+        return;
+    }
+    c->lag_slot_start = slot_start;
+    
+    if (c->lag_samples == 0) {
+        c->lag_mean = offset;
+        c->lag_var = 0;
+    } else {
+        double diff = offset - c->lag_mean;
+        c->lag_mean += diff / LAG_GAIN;
+        c->lag_var += (diff * diff - c->lag_var) / LAG_GAIN;
+    }
+    c->lag_samples++;
+    
+    // late: a message sent at the end of the client's slot arrives about lag later
+    double stddev = sqrt(c->lag_var);
+    double late = c->lag_mean + 3 * stddev;
+    double early = 3 * stddev;
+    c->guard_late = (late < 0) ? 0 : (late > MAX_GUARD_MS) ? MAX_GUARD_MS : (int)(late + 0.5);
+    c->guard_early = (early > MAX_GUARD_MS) ? MAX_GUARD_MS : (int)(early + 0.5);
+}
+
+// check slot ownership for one received line and forward or reject it
+void handle_client_line(int i, const char *line) {
+    long long now = get_time_ms();
+    long long offset = slot_offset_ms(i, now);
+    
+    // the client tags a line it had queued before its slot began, it was sent
+    // right at the slot start so its arrival shows the link lag
+    int lag_sample = 0;
+    if (strncmp(line, SYNC_TAG, SYNC_TAG_LEN) == 0) {
+        line += SYNC_TAG_LEN;
+        lag_sample = 1;
+    }
+    
+    // lines over the configured limit are dropped whatever the slot
+    int len = strlen(line);
+    if (len > config.max_message) {
+        char error_msg[200];
+        snprintf(error_msg, sizeof(error_msg),
+                "TOO_LONG|length=%d|max_message=%d|message_dropped\n", len, config.max_message);
+        client_send(i, error_msg, strlen(error_msg));
+        printf("[CONFIG] Client %d sent %d bytes, limit is %d, dropped\n", i + 1, len, config.max_message);
+        return;
+    }
+    
+    // Check if client is transmitting in their assigned slot, widened by its guards.
+    // until apply_admissions() the frame has no slot for a new client, its
+    // index would alias onto another station's slot, so it is always outside
+    if (!clients[i].awaiting_layout &&
+        offset >= -clients[i].guard_early && offset < config.slot_duration_ms + clients[i].guard_late) {
+        // Client is in their slot - allow transmission
+        if (lag_sample) {
+            update_drift(i, offset, now - offset);
+        }
+        clients[i].avg_msg_len += (len - clients[i].avg_msg_len) / 8;
+        clients[i].credits_used++;
+        broadcast_message(line, i);
+    } else {
+        // Client is transmitting outside their slot - collision detected
+        char error_msg[200];
+        unsigned int frag_id, frag_off;
+        
+        // name dropped fragments so the sender can resend them
+        if (sscanf(line, "FRAG|id=%u|off=%u", &frag_id, &frag_off) == 2) {
+            snprintf(error_msg, sizeof(error_msg),
+                    "COLLISION|your_slot=%d|current_slot=%d|message_dropped|frag=%u:%u\n",
+                    clients[i].slot_number, tdma.current_slot, frag_id, frag_off);
+        } else {
+            snprintf(error_msg, sizeof(error_msg),
+                    "COLLISION|your_slot=%d|current_slot=%d|message_dropped\n",
+                    clients[i].slot_number, tdma.current_slot);
+        }
+        client_send(i, error_msg, strlen(error_msg));
+        
+        printf("[COLLISION] Client %d attempted transmission in Slot %d (assigned Slot %d, %lld ms from its slot start, guard -%d/+%d ms)\n",
+               i + 1, tdma.current_slot, clients[i].slot_number, offset,
+               clients[i].guard_early, clients[i].guard_late);
+    }
+}
+
+// split a client's receive buffer into newline terminated messages
+void process_client_buffer(int i) {
+    Client *c = &clients[i];
+    int start = 0;
+    
+    for (int pos = 0; pos < c->rx_len; pos++) {
+        if (c->rx_buf[pos] == '\n') {
+            c->rx_buf[pos] = '\0';
+            
+            // a reconnecting client takes its old entry back, the temporary
+            // one it was given on accept is released without closing the socket
+            if (c->shm == NULL && strncmp(c->rx_buf + start, "RESUME|", 7) == 0) {
+                int j = resume_client(c->socket, c->rx_buf + start);
+                if (j >= 0) {
+                    Client *r = &clients[j];
+                    r->rx_len = c->rx_len - (pos + 1);
+                    memcpy(r->rx_buf, c->rx_buf + pos + 1, r->rx_len);
+                    
+                    // replay follows the socket from the temporary index to j
+                    capture_event(CAP_DISCONNECT, i, NULL, 0);
+                    if (c->awaiting_layout) {
+                        c->awaiting_layout = 0;
+                        admitted_count--;
+                    }
+                    c->socket = -1;
+                    c->active = 0;
+                    c->slot_number = -1;
+                    c->rx_len = 0;
+                    c->token[0] = '\0';
+                    client_count--;
+                    update_active_slots();
+                    
+                    process_client_buffer(j);
+                    return;
+                }
+                start = pos + 1;
+                continue;
+            }
+            
+            if (pos > start) {
+                handle_client_line(i, c->rx_buf + start);
+            }
+            start = pos + 1;
+        }
+    }
+    
+    // a full buffer without a newline is handled as one message
+    if (start == 0 && c->rx_len == BUFFER_SIZE - 1) {
+        c->rx_buf[c->rx_len] = '\0';
+        handle_client_line(i, c->rx_buf);
+        start = c->rx_len;
+    }
+    
+    // keep the incomplete tail for the next read
+    c->rx_len -= start;
+    if (c->rx_len > 0 && start > 0) {
+        memmove(c->rx_buf, c->rx_buf + start, c->rx_len);
+    }
+}
+
+// open the Unix-domain socket local clients use to request shared memory
+int open_local_listener(const char *path) {
+    struct sockaddr_un addr;
+    int sd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (sd < 0) {
+        return -1;
+    }
+    
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strncpy(addr.sun_path, path, sizeof(addr.sun_path) - 1);
+    unlink(path);
+    
+    if (bind(sd, (struct sockaddr *)&addr, sizeof(addr)) < 0 || listen(sd, MAX_CLIENTS) < 0) {
+        close(sd);
+        return -1;
+    }
+    return sd;
+}
+
+// admit a local client: give it a slot, then pass it a memfd with its rings
+// and the two doorbell eventfds over the Unix socket
+void accept_local_client(int local_socket) {
+    int sd = accept(local_socket, NULL, NULL);
+    if (sd < 0) {
+        perror("Local accept failed");
+        return;
+    }
+    
+    int memfd = memfd_create("tdma_client", 0);
+    int doorbell_in = eventfd(0, EFD_NONBLOCK);
+    int doorbell_out = eventfd(0, EFD_NONBLOCK);
+    ShmRegion *shm = MAP_FAILED;
+    if (memfd >= 0 && ftruncate(memfd, sizeof(ShmRegion)) == 0) {
+        shm = mmap(NULL, sizeof(ShmRegion), PROT_READ | PROT_WRITE, MAP_SHARED, memfd, 0);
+    }
+    
+    struct sockaddr_in no_address;
+    memset(&no_address, 0, sizeof(no_address));
+    int client_index = -1;
+    if (shm != MAP_FAILED && doorbell_in >= 0 && doorbell_out >= 0) {
+        client_index = add_client(sd, no_address);
+    }
+    
+    if (client_index < 0) {
+        printf("Local client rejected\n");
+        if (shm != MAP_FAILED) {
+            munmap(shm, sizeof(ShmRegion));
+        }
+        if (memfd >= 0) close(memfd);
+        if (doorbell_in >= 0) close(doorbell_in);
+        if (doorbell_out >= 0) close(doorbell_out);
+        close(sd);
+        return;
+    }
+    
+    shm_ring_init(&shm->to_server);
+    shm_ring_init(&shm->to_client);
+    clients[client_index].shm = shm;
+    clients[client_index].doorbell_in = doorbell_in;
+    clients[client_index].doorbell_out = doorbell_out;
+    
+    // fds travel as SCM_RIGHTS ancillary data next to one dummy byte
+    int fds[3] = {memfd, doorbell_in, doorbell_out};
+    char cmsg_buf[CMSG_SPACE(sizeof(fds))];
+    char dummy = 'S';
+    struct iovec iov = {&dummy, 1};
+    struct msghdr msg;
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = cmsg_buf;
+    msg.msg_controllen = sizeof(cmsg_buf);
+    struct cmsghdr *cmsg = CMSG_FIRSTHDR(&msg);
+    cmsg->cmsg_level = SOL_SOCKET;
+    cmsg->cmsg_type = SCM_RIGHTS;
+    cmsg->cmsg_len = CMSG_LEN(sizeof(fds));
+    memcpy(CMSG_DATA(cmsg), fds, sizeof(fds));
+    
+    int sent = sendmsg(sd, &msg, 0);
+    close(memfd);  // our mapping keeps the memory alive
+    if (sent < 0) {
+        perror("Local handshake failed");
+        remove_local_client(client_index);
+        return;
+    }
+    
+    printf("Local client %d connected over shared memory and assigned to Slot %d. Total clients: %d\n",
+           client_index + 1, clients[client_index].slot_number, client_count);
+    capture_event(CAP_ACCEPT, client_index, &no_address, sizeof(no_address));
+    send_welcome(client_index);
+}
+
+// pull everything a local client wrote into its ring through the line splitter
+void drain_local_client(int i) {
+    uint64_t count;
+    if (read(clients[i].doorbell_in, &count, sizeof(count)) < 0) {
+        // doorbell already cleared, the ring is drained anyway
+    }
+    
+    while (clients[i].active && clients[i].shm != NULL) {
+        int n = shm_ring_read(&clients[i].shm->to_server, clients[i].rx_buf + clients[i].rx_len,
+                              BUFFER_SIZE - 1 - clients[i].rx_len);
+        if (n == 0) {
+            break;
+        }
+        capture_event(CAP_PAYLOAD, i, clients[i].rx_buf + clients[i].rx_len, n);
+        clients[i].rx_len += n;
+        process_client_buffer(i);
+    }
+}
+
+// read from a connection accepted while full, it gets a slot only by resuming
+void process_pending(int p) {
+    PendingConnection *pc = &pending[p];
+    int valread = read(pc->socket, pc->rx_buf + pc->rx_len, BUFFER_SIZE - 1 - pc->rx_len);
+    
+    if (valread > 0) {
+        pc->rx_len += valread;
+        pc->rx_buf[pc->rx_len] = '\0';
+        char *newline = strchr(pc->rx_buf, '\n');
+        if (newline == NULL && pc->rx_len < BUFFER_SIZE - 1) {
+            return;  // wait for the rest of the line
+        }
+        
+        int j = -1;
+        if (newline != NULL) {
+            *newline = '\0';
+            j = resume_client(pc->socket, pc->rx_buf);
+        }
+        if (j >= 0) {
+            // pass on anything sent after the RESUME line
+            clients[j].rx_len = pc->rx_len - (newline + 1 - pc->rx_buf);
+            memcpy(clients[j].rx_buf, newline + 1, clients[j].rx_len);
+            if (clients[j].rx_len > 0) {
+                capture_event(CAP_PAYLOAD, j, clients[j].rx_buf, clients[j].rx_len);
+            }
+            process_client_buffer(j);
+            pc->socket = -1;
+            return;
+        }
+    }
+    
+    printf("Maximum clients reached. Connection rejected.\n");
+    close(pc->socket);
+    pc->socket = -1;
+}
+
+// drop full-server connections that never sent a valid RESUME
+void expire_pending() {
+    long long now = get_time_ms();
+    
+    for (int p = 0; p < MAX_PENDING; p++) {
+        if (pending[p].socket >= 0 && now - pending[p].accepted_at >= PENDING_TIMEOUT_MS) {
+            printf("Maximum clients reached. Connection rejected.\n");
+            close(pending[p].socket);
+            pending[p].socket = -1;
+        }
+    }
+}
+
+// admit one accepted connection, or park it if it may be a returning client
+void admit_connection(int new_socket, struct sockaddr_in client_addr) {
+    printf("New connection from %s:%d\n", 
+           inet_ntoa(client_addr.sin_addr), 
+           ntohs(client_addr.sin_port));
+    set_keepalive(new_socket);
+    
+    int client_index = add_client(new_socket, client_addr);
+    
+    // when full, a suspended client may still be coming back
+    int pending_index = -1;
+    if (client_index < 0) {
+        for (int i = 0; i < MAX_CLIENTS; i++) {
+            if (clients[i].suspended) {
+                for (int p = 0; p < MAX_PENDING && pending_index < 0; p++) {
+                    if (pending[p].socket < 0) {
+                        pending_index = p;
+                    }
+                }
+                break;
+            }
+        }
+    }
+    
+    if (client_index >= 0) {
+        printf("Client %d connected and assigned to Slot %d. Total clients: %d\n", 
+               client_index + 1, clients[client_index].slot_number, client_count);
+        capture_event(CAP_ACCEPT, client_index, &client_addr, sizeof(client_addr));
+        
+        // Send welcome message, TDMA info follows at the next frame
+        send_welcome(client_index);
+    } else if (pending_index >= 0) {
+        pending[pending_index].socket = new_socket;
+        pending[pending_index].accepted_at = get_time_ms();
+        pending[pending_index].rx_len = 0;
+    } else {
+        printf("Maximum clients reached. Connection rejected.\n");
+        close(new_socket);
+    }
+}
+
+// take every connection the kernel has queued, the listener is non-blocking
+// so stations powering up together are all admitted in one pass
+void accept_clients(int server_socket) {
+    struct sockaddr_in client_addr;
+    socklen_t addr_len;
+    int accepted = 0;
+    
+    while (1) {
+        addr_len = sizeof(client_addr);
+        int new_socket = accept(server_socket, (struct sockaddr *)&client_addr, &addr_len);
+        if (new_socket < 0) {
+            if (errno == EINTR || errno == ECONNABORTED) {
+                continue;  // that one went away before we got to it
+            }
+            if (errno != EAGAIN && errno != EWOULDBLOCK) {
+                perror("Accept failed");
+            }
+            break;
+        }
+        admit_connection(new_socket, client_addr);
+        accepted++;
+    }
+    
+    if (accepted > 1) {
+        printf("Accepted %d connections in one pass\n", accepted);
+    }
+}
+
+// open the TCP listening socket, returns -1 with errno set on failure
+int open_listener(int port, int backlog) {
+    struct sockaddr_in server_addr;
+    int sd = socket(AF_INET, SOCK_STREAM, 0);
+    if (sd < 0) {
+        return -1;
     }
     
     // Set socket options to reuse address
     int opt = 1;
-    if (setsockopt(server_socket, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt)) < 0) {
-        perror("Setsockopt failed");
-        exit(EXIT_FAILURE);
-    }
+    setsockopt(sd, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt));
     
     // Configure server address
     server_addr.sin_family = AF_INET;
     server_addr.sin_addr.s_addr = INADDR_ANY;
-    server_addr.sin_port = htons(PORT);
+    server_addr.sin_port = htons(port);
+    
+    // non-blocking so accept_clients() can drain the queue until it is empty
+    fcntl(sd, F_SETFL, fcntl(sd, F_GETFL) | O_NONBLOCK);
+    
+    if (bind(sd, (struct sockaddr *)&server_addr, sizeof(server_addr)) < 0 || listen(sd, backlog) < 0) {
+        int saved = errno;
+        close(sd);
+        errno = saved;
+        return -1;
+    }
+    return sd;
+}
+
+int main(int argc, char *argv[]) {
+    int server_socket, max_sd, activity;
+    struct sockaddr_in client_addr;
+    socklen_t addr_len = sizeof(client_addr);
+    fd_set read_fds;
+    struct timeval timeout;
+    
+    initialize_clients();
+    initialize_tdma();
+    
+    // optional traffic capture for ./replay, real-time slot timing and local clients
+    const char *capture_path = NULL;
+    const char *local_path = NULL;
+    int local_socket = -1;
+    // settings given on the command line, checked like config file lines
+    const char *cli_keys[] = {"port", "max_clients", "max_message", "slot_duration_ms", "listen_backlog"};
+    const char *cli_values[5] = {NULL, NULL, NULL, NULL, NULL};
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-r") == 0 && i + 1 < argc) {
+            capture_path = argv[++i];
+        } else if (strcmp(argv[i], "-t") == 0 && i + 1 < argc) {
+            rt_mode = 1;
+            rt_cpu = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "-l") == 0) {
+            local_path = SHM_SOCKET_PATH;
+        } else if (strcmp(argv[i], "-c") == 0 && i + 1 < argc) {
+            config_path = argv[++i];
+        } else if (strcmp(argv[i], "-p") == 0 && i + 1 < argc) {
+            cli_values[0] = argv[++i];
+        } else if (strcmp(argv[i], "-n") == 0 && i + 1 < argc) {
+            cli_values[1] = argv[++i];
+        } else if (strcmp(argv[i], "-m") == 0 && i + 1 < argc) {
+            cli_values[2] = argv[++i];
+        } else if (strcmp(argv[i], "-s") == 0 && i + 1 < argc) {
+            cli_values[3] = argv[++i];
+        } else if (strcmp(argv[i], "-b") == 0 && i + 1 < argc) {
+            cli_values[4] = argv[++i];
+        } else {
+            printf("Usage: %s [-c config_file] [-p port] [-n max_clients] [-m max_message] [-s slot_ms]\n"
+                   "       [-b listen_backlog] [-r capture_file] [-t timing_cpu] [-l]\n", argv[0]);
+            printf("  -c reads key=value settings (port, max_clients, max_message, slot_duration_ms,\n");
+            printf("     listen_backlog),\n");
+            printf("     kill -HUP the server to reload it, changes apply at the next frame boundary\n");
+            printf("  -n is at most %d, -m at most %d bytes, -s between %d and %d ms, -b at most %d\n",
+                   MAX_CLIENTS, BUFFER_SIZE - 1, MIN_SLOT_MS, MAX_SLOT_MS, MAX_BACKLOG);
+            printf("  -t runs slot timing on its own thread pinned to timing_cpu (-1 to not pin)\n");
+            printf("  -l accepts shared-memory clients on this host through %s\n", SHM_SOCKET_PATH);
+            exit(EXIT_FAILURE);
+        }
+    }
     
-    // Bind socket
-    if (bind(server_socket, (struct sockaddr *)&server_addr, sizeof(server_addr)) < 0) {
-        perror("Bind failed");
+    // defaults, then the config file, then the command line
+    if (config_path != NULL) {
+        int errors = config_load(config_path, apply_server_setting, &config);
+        if (errors != 0) {
+            printf("Config file %s %s\n", config_path, errors < 0 ? "could not be read" : "has errors");
+            exit(EXIT_FAILURE);
+        }
+    }
+    for (int k = 0; k < 5; k++) {
+        if (cli_values[k] != NULL && apply_server_setting(&config, cli_keys[k], cli_values[k]) != 0) {
+            printf("Invalid %s: %s\n", cli_keys[k], cli_values[k]);
+            exit(EXIT_FAILURE);
+        }
+    }
+    atomic_store(&rt_slot_duration_ms, config.slot_duration_ms);
+    signal(SIGHUP, handle_sighup);
+    if (capture_path != NULL && open_capture(capture_path) < 0) {
+        perror("Capture file open failed");
         exit(EXIT_FAILURE);
     }
     
-    // Listen for connections
-    if (listen(server_socket, 3) < 0) {
+    // Create, bind and listen
+    if ((server_socket = open_listener(config.port, config.listen_backlog)) < 0) {
         perror("Listen failed");
         exit(EXIT_FAILURE);
     }
+    int listen_port = config.port;
+    int listen_backlog = config.listen_backlog;
     
     printf("=== TDMA Server Started ===\n");
-    printf("Port: %d\n", PORT);
-    printf("Slot Duration: %d ms\n", SLOT_DURATION_MS);
+    printf("Port: %d\n", config.port);
+    printf("Slot Duration: %d ms\n", config.slot_duration_ms);
+    printf("Max Clients: %d | Max Message: %d bytes | Listen Backlog: %d\n",
+           config.max_clients, config.max_message, config.listen_backlog);
+    if (config_path != NULL) {
+        printf("Config: %s (reload with kill -HUP %d)\n", config_path, (int)getpid());
+    }
     printf("Dynamic frame sizing enabled\n");
+    if (capture_file != NULL) {
+        printf("Recording traffic to %s\n", capture_path);
+    }
+    if (rt_mode && start_slot_timer() < 0) {
+        exit(EXIT_FAILURE);
+    }
+    if (local_path != NULL) {
+        if ((local_socket = open_local_listener(local_path)) < 0) {
+            perror("Local listener failed");
+            exit(EXIT_FAILURE);
+        }
+        printf("Shared-memory clients: %s\n", local_path);
+    }
+    long long last_rt_report = get_time_ms();
     printf("Waiting for client connections...\n\n");
     
     while (1) {
-        // Update TDMA scheduling
-        int prev_slot = tdma.current_slot;
-        update_tdma_slot();
+        // Update TDMA scheduling, the timing thread does this in real-time mode
+        if (reload_requested) {
+            reload_config();
+        }
         
-        // Notify clients when slot changes
-        if (prev_slot != tdma.current_slot && prev_slot != -1) {
-            broadcast_slot_change();
+        if (!rt_mode) {
+            int prev_slot = tdma.current_slot;
+            int prev_frame = tdma.frame_number;
+            update_tdma_slot();
+            if (tdma.frame_number != prev_frame) {
+                apply_pending_config(atomic_load(&rt_slot_duration_ms));
+                apply_admissions();
+            }
+            
+            // Notify clients when slot changes
+            if (prev_slot != tdma.current_slot && prev_slot != -1) {
+                capture_event(CAP_SLOT, 0, NULL, 0);
+                broadcast_slot_change();
+            }
+        } else if (get_time_ms() - last_rt_report >= RT_REPORT_MS) {
+            print_rt_stats();
+            last_rt_report = get_time_ms();
+        }
+        
+        // a reload moved the port, existing connections stay where they are
+        if (config.port != listen_port) {
+            int sd = open_listener(config.port, config.listen_backlog);
+            if (sd < 0) {
+                perror("[CONFIG] Listen on new port failed");
+                printf("[CONFIG] Still listening on port %d\n", listen_port);
+                config.port = listen_port;
+            } else {
+                close(server_socket);
+                server_socket = sd;
+                listen_port = config.port;
+                listen_backlog = config.listen_backlog;
+                printf("[CONFIG] Now listening on port %d\n", listen_port);
+            }
+        } else if (config.listen_backlog != listen_backlog) {
+            // listen() again on the same socket just resizes its queue
+            if (listen(server_socket, config.listen_backlog) < 0) {
+                perror("[CONFIG] Changing listen backlog failed");
+                config.listen_backlog = listen_backlog;
+            } else {
+                listen_backlog = config.listen_backlog;
+                printf("[CONFIG] Listen backlog now %d\n", listen_backlog);
+            }
         }
         
         // Clear the socket set
@@ -277,12 +1559,46 @@ int main() {
         FD_SET(server_socket, &read_fds);
         max_sd = server_socket;
         
+        // slot boundary doorbell from the timing thread
+        if (rt_mode) {
+            FD_SET(rt_eventfd, &read_fds);
+            if (rt_eventfd > max_sd) {
+                max_sd = rt_eventfd;
+            }
+        }
+        
+        // Add the shared-memory handshake socket
+        if (local_socket >= 0) {
+            FD_SET(local_socket, &read_fds);
+            if (local_socket > max_sd) {
+                max_sd = local_socket;
+            }
+        }
+        
+        // Add connections waiting to resume
+        for (int p = 0; p < MAX_PENDING; p++) {
+            if (pending[p].socket >= 0) {
+                FD_SET(pending[p].socket, &read_fds);
+                if (pending[p].socket > max_sd) {
+                    max_sd = pending[p].socket;
+                }
+            }
+        }
+        
         // Add client sockets to set
         for (int i = 0; i < MAX_CLIENTS; i++) {
             int sd = clients[i].socket;
             
             if (clients[i].active) {
                 FD_SET(sd, &read_fds);
+                
+                // local clients ring this instead of writing to the socket
+                if (clients[i].shm != NULL) {
+                    FD_SET(clients[i].doorbell_in, &read_fds);
+                    if (clients[i].doorbell_in > max_sd) {
+                        max_sd = clients[i].doorbell_in;
+                    }
+                }
             }
             
             if (sd > max_sd) {
@@ -293,6 +1609,11 @@ int main() {
         // Set timeout for select (10mS to check TDMA timing frequently to prevent drift from 100mS)
         timeout.tv_sec = 0;
         timeout.tv_usec = 10000;  // 10mS
+        if (rt_mode) {
+            // boundaries wake select through the eventfd, no polling needed
+            timeout.tv_sec = config.slot_duration_ms / 1000;
+            timeout.tv_usec = (config.slot_duration_ms % 1000) * 1000;
+        }
         
         // Wait for activity on sockets
         activity = select(max_sd + 1, &read_fds, NULL, NULL, &timeout);
@@ -300,47 +1621,59 @@ int main() {
         if ((activity < 0) && (errno != EINTR)) {
             printf("Select error\n");
         }
+        if (activity < 0) {
+            continue;  // the fd sets are undefined, e.g. after SIGHUP
+        }
+        
+        // Apply slot boundaries first so messages are checked against the new slot
+        if (rt_mode && activity > 0 && FD_ISSET(rt_eventfd, &read_fds)) {
+            drain_slot_events();
+        }
         
-        // Check for new connection
+        // Check for new connections
         if (FD_ISSET(server_socket, &read_fds)) {
-            if ((new_socket = accept(server_socket, (struct sockaddr *)&client_addr, &addr_len)) < 0) {
-                perror("Accept failed");
-                continue;
-            }
-            
-            printf("New connection from %s:%d\n", 
-                   inet_ntoa(client_addr.sin_addr), 
-                   ntohs(client_addr.sin_port));
-            
-            int client_index = add_client(new_socket, client_addr);
-            if (client_index >= 0) {
-                printf("Client %d connected and assigned to Slot %d. Total clients: %d\n", 
-                       client_index + 1, clients[client_index].slot_number, client_count);
-                
-                // Send welcome message with TDMA info
-                char welcome[200];
-                snprintf(welcome, sizeof(welcome), 
-                        "WELCOME|client_id=%d|slot=%d|slot_duration=%d\n",
-                        client_index + 1, 
-                        clients[client_index].slot_number,
-                        SLOT_DURATION_MS);
-                send(new_socket, welcome, strlen(welcome), 0);
-                
-                // Send initial TDMA timing info
-                send_tdma_info_to_client(client_index);
-            } else {
-                printf("Maximum clients reached. Connection rejected.\n");
-                close(new_socket);
+            accept_clients(server_socket);
+        }
+        
+        // Check for new shared-memory client
+        if (local_socket >= 0 && FD_ISSET(local_socket, &read_fds)) {
+            accept_local_client(local_socket);
+        }
+        
+        // Check connections waiting to resume
+        for (int p = 0; p < MAX_PENDING; p++) {
+            if (pending[p].socket >= 0 && FD_ISSET(pending[p].socket, &read_fds)) {
+                process_pending(p);
             }
         }
+        expire_pending();
+        expire_suspended_clients();
         
         // Check for I/O operation on client sockets
         for (int i = 0; i < MAX_CLIENTS; i++) {
             int sd = clients[i].socket;
             
-            if (clients[i].active && FD_ISSET(sd, &read_fds)) {
-                memset(buffer, 0, BUFFER_SIZE);
-                int valread = read(sd, buffer, BUFFER_SIZE - 1);
+            if (clients[i].active && clients[i].shm != NULL) {
+                if (FD_ISSET(clients[i].doorbell_in, &read_fds)) {
+                    drain_local_client(i);
+                }
+                
+                // the handshake socket only closes, it carries no data
+                char probe;
+                if (FD_ISSET(sd, &read_fds) && recv(sd, &probe, 1, MSG_DONTWAIT) <= 0) {
+                    printf("Local client %d (Slot %d) disconnected\n", i + 1, clients[i].slot_number);
+                    capture_event(CAP_DISCONNECT, i, NULL, 0);
+                    remove_local_client(i);
+                    printf("Total clients: %d\n", client_count);
+                }
+            } else if (clients[i].active && FD_ISSET(sd, &read_fds)) {
+                // non-blocking, a resumed socket can show up again under its new index
+                int valread = recv(sd, clients[i].rx_buf + clients[i].rx_len,
+                                   BUFFER_SIZE - 1 - clients[i].rx_len, MSG_DONTWAIT);
+                
+                if (valread < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+                    continue;
+                }
                 
                 if (valread <= 0) {
                     // Client disconnected
@@ -351,26 +1684,13 @@ int main() {
                            inet_ntoa(client_addr.sin_addr),
                            ntohs(client_addr.sin_port));
                     
-                    remove_client(i);
+                    capture_event(CAP_DISCONNECT, i, NULL, 0);
+                    suspend_client(i);
                     printf("Total clients: %d\n", client_count);
                 } else {
-                    buffer[valread] = '\0';
-                    
-                    // Check if client is transmitting in their assigned slot
-                    if (clients[i].slot_number == tdma.current_slot) {
-                        // Client is in their slot - allow transmission
-                        broadcast_message(buffer, i);
-                    } else {
-                        // Client is transmitting outside their slot - collision detected
-                        char error_msg[200];
-                        snprintf(error_msg, sizeof(error_msg),
-                                "COLLISION|your_slot=%d|current_slot=%d|message_dropped\n",
-                                clients[i].slot_number, tdma.current_slot);
-                        send(sd, error_msg, strlen(error_msg), 0);
-                        
-                        printf("[COLLISION] Client %d attempted transmission in Slot %d (assigned Slot %d)\n",
-                               i + 1, tdma.current_slot, clients[i].slot_number);
-                    }
+                    capture_event(CAP_PAYLOAD, i, clients[i].rx_buf + clients[i].rx_len, valread);
+                    clients[i].rx_len += valread;
+                    process_client_buffer(i);
                 }
             }
         }
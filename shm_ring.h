@@ -0,0 +1,85 @@
+#ifndef SHM_RING_H
+#define SHM_RING_H
+
+#include <stdatomic.h>
+#include <string.h>
+
+// shared-memory transport for clients running on the server host
+// the server hands a local client a memfd holding one ShmRegion plus two
+// eventfd doorbells over a Unix-domain socket, after that all protocol
+// lines go through the rings instead of the TCP stack
+
+#define SHM_RING_BYTES (64 * 1024)  // must be a power of two
+#define SHM_SOCKET_PATH "/tmp/tdma_server.sock"
+
+// single producer / single consumer byte ring carrying newline separated lines
+// head and tail run freely and are masked on access
+typedef struct {
+    atomic_uint head;  // read position, owned by the consumer
+    char pad_head[60];
+    atomic_uint tail;  // write position, owned by the producer
+    char pad_tail[60];
+    char data[SHM_RING_BYTES];
+} ShmRing;
+
+// one region per local client
+typedef struct {
+    ShmRing to_server;
+    ShmRing to_client;
+} ShmRegion;
+
+static inline void shm_ring_init(ShmRing *ring) {
+    atomic_init(&ring->head, 0);
+    atomic_init(&ring->tail, 0);
+}
+
+// bytes written but not yet read
+static inline unsigned int shm_ring_used(ShmRing *ring) {
+    return atomic_load_explicit(&ring->tail, memory_order_acquire) -
+           atomic_load_explicit(&ring->head, memory_order_acquire);
+}
+
+// append len bytes, all or nothing, returns 0 if there is not enough room
+static inline int shm_ring_write(ShmRing *ring, const char *data, unsigned int len) {
+    unsigned int tail = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+    unsigned int head = atomic_load_explicit(&ring->head, memory_order_acquire);
+
+    if (SHM_RING_BYTES - (tail - head) < len) {
+        return 0;
+    }
+
+    unsigned int pos = tail & (SHM_RING_BYTES - 1);
+    unsigned int first = SHM_RING_BYTES - pos;
+    if (first > len) {
+        first = len;
+    }
+    memcpy(ring->data + pos, data, first);
+    memcpy(ring->data, data + first, len - first);
+
+    atomic_store_explicit(&ring->tail, tail + len, memory_order_release);
+    return 1;
+}
+
+// copy out up to max bytes, returns how many were read
+static inline unsigned int shm_ring_read(ShmRing *ring, char *data, unsigned int max) {
+    unsigned int head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+    unsigned int tail = atomic_load_explicit(&ring->tail, memory_order_acquire);
+    unsigned int len = tail - head;
+
+    if (len > max) {
+        len = max;
+    }
+
+    unsigned int pos = head & (SHM_RING_BYTES - 1);
+    unsigned int first = SHM_RING_BYTES - pos;
+    if (first > len) {
+        first = len;
+    }
+    memcpy(data, ring->data + pos, first);
+    memcpy(data + first, ring->data, len - first);
+
+    atomic_store_explicit(&ring->head, head + len, memory_order_release);
+    return len;
+}
+
+#endif